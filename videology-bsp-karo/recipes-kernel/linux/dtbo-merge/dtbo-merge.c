@@ -0,0 +1,545 @@
+// SPDX-License-Identifier: MIT
+// Merges several device-tree overlay blobs into one, so they can be applied with a single configfs
+// write (one OF notifier round and one driver re-probe) instead of one per overlay.
+//
+// Per input overlay the local phandles are shifted past the ones already merged (and the references
+// listed in __local_fixups__ patched to match), the top-level fragments are renumbered, and the
+// paths in __fixups__ and __symbols__ are rewritten to the new fragment names.
+//
+// Also built for the host, to pre-merge known overlay sets in karo-devicetrees.bb.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <arpa/inet.h>
+
+#define FDT_MAGIC       0xd00dfeed
+#define FDT_BEGIN_NODE  1
+#define FDT_END_NODE    2
+#define FDT_PROP        3
+#define FDT_NOP         4
+#define FDT_END         9
+
+#define FDT_ALIGN(x)    (((x) + 3) & ~3u)
+
+struct prop {
+    char *name;
+    unsigned char *data;
+    uint32_t len;
+    struct prop *next;
+};
+
+struct node {
+    char *name;
+    struct prop *props;
+    struct node *children;
+    struct node *next;
+};
+
+struct fdt_header {
+    uint32_t magic;
+    uint32_t totalsize;
+    uint32_t off_dt_struct;
+    uint32_t off_dt_strings;
+    uint32_t off_mem_rsvmap;
+    uint32_t version;
+    uint32_t last_comp_version;
+    uint32_t boot_cpuid_phys;
+    uint32_t size_dt_strings;
+    uint32_t size_dt_struct;
+};
+
+static const char *prog;
+
+static void *xmalloc(size_t len) {
+    void *p = calloc(1, len ? len : 1);
+
+    if (!p) {
+        perror(prog);
+        exit(1);
+    }
+    return p;
+}
+
+static char *xstrdup(const char *s) {
+    char *p = xmalloc(strlen(s) + 1);
+
+    return strcpy(p, s);
+}
+
+static uint32_t get_be32(const unsigned char *p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static void put_be32(unsigned char *p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+// ---------------------------------------------------------------------------------------------
+// blob <-> tree
+
+static struct prop *add_prop(struct node *n, const char *name, const void *data, uint32_t len) {
+    struct prop *p = xmalloc(sizeof(*p)), **tail = &n->props;
+
+    p->name = xstrdup(name);
+    p->data = xmalloc(len);
+    memcpy(p->data, data, len);
+    p->len = len;
+    while (*tail)
+        tail = &(*tail)->next;
+    *tail = p;
+    return p;
+}
+
+static void add_child(struct node *parent, struct node *child) {
+    struct node **tail = &parent->children;
+
+    while (*tail)
+        tail = &(*tail)->next;
+    child->next = NULL;
+    *tail = child;
+}
+
+static void remove_child(struct node *parent, struct node *child) {
+    for (struct node **c = &parent->children; *c; c = &(*c)->next) {
+        if (*c == child) {
+            *c = child->next;
+            child->next = NULL;
+            return;
+        }
+    }
+}
+
+static struct node *parse_blob(const unsigned char *blob, size_t size, const char *path) {
+    const unsigned char *st, *strs;
+    uint32_t st_size, strs_size, off = 0;
+    struct node *stack[64], *root = NULL;
+    int depth = 0;
+
+    if (size < sizeof(struct fdt_header) || get_be32(blob) != FDT_MAGIC || get_be32(blob + 4) > size) {
+        fprintf(stderr, "%s: %s: not a device-tree blob\n", prog, path);
+        return NULL;
+    }
+    st = blob + get_be32(blob + 8);
+    strs = blob + get_be32(blob + 12);
+    strs_size = get_be32(blob + 32);
+    st_size = get_be32(blob + 36);
+    if (get_be32(blob + 20) < 17)
+        st_size = size - get_be32(blob + 8);
+
+    while (off + 4 <= st_size) {
+        uint32_t tag = get_be32(st + off);
+
+        off += 4;
+        switch (tag) {
+        case FDT_BEGIN_NODE: {
+            const char *name = (const char *)st + off;
+            struct node *n;
+
+            if (depth >= (int)(sizeof(stack) / sizeof(stack[0])))
+                goto bad;
+            n = xmalloc(sizeof(*n));
+            n->name = xstrdup(name);
+            off = FDT_ALIGN(off + strlen(name) + 1);
+            if (depth)
+                add_child(stack[depth - 1], n);
+            else
+                root = n;
+            stack[depth++] = n;
+            break;
+        }
+        case FDT_END_NODE:
+            if (!depth)
+                goto bad;
+            depth--;
+            break;
+        case FDT_PROP: {
+            uint32_t len = get_be32(st + off), nameoff = get_be32(st + off + 4);
+
+            if (!depth || nameoff >= strs_size || off + 8 + len > st_size)
+                goto bad;
+            add_prop(stack[depth - 1], (const char *)strs + nameoff, st + off + 8, len);
+            off = FDT_ALIGN(off + 8 + len);
+            break;
+        }
+        case FDT_NOP:
+            break;
+        case FDT_END:
+            if (depth || !root)
+                goto bad;
+            return root;
+        default:
+            goto bad;
+        }
+    }
+bad:
+    fprintf(stderr, "%s: %s: corrupt structure block\n", prog, path);
+    return NULL;
+}
+
+struct buf {
+    unsigned char *data;
+    size_t len, cap;
+};
+
+static void buf_put(struct buf *b, const void *data, size_t len) {
+    if (b->len + len + 4 > b->cap) {
+        b->cap = (b->cap + len + 4) * 2;
+        b->data = realloc(b->data, b->cap);
+        if (!b->data) {
+            perror(prog);
+            exit(1);
+        }
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+}
+
+static void buf_put32(struct buf *b, uint32_t v) {
+    unsigned char be[4];
+
+    put_be32(be, v);
+    buf_put(b, be, 4);
+}
+
+static void buf_align(struct buf *b) {
+    static const unsigned char zero[4];
+
+    buf_put(b, zero, FDT_ALIGN(b->len) - b->len);
+}
+
+static uint32_t string_offset(struct buf *strs, const char *name) {
+    for (size_t off = 0; off < strs->len; off += strlen((char *)strs->data + off) + 1)
+        if (strcmp((char *)strs->data + off, name) == 0)
+            return off;
+    buf_put(strs, name, strlen(name) + 1);
+    return strs->len - strlen(name) - 1;
+}
+
+static void flatten(struct node *n, struct buf *st, struct buf *strs) {
+    buf_put32(st, FDT_BEGIN_NODE);
+    buf_put(st, n->name, strlen(n->name) + 1);
+    buf_align(st);
+    for (struct prop *p = n->props; p; p = p->next) {
+        buf_put32(st, FDT_PROP);
+        buf_put32(st, p->len);
+        buf_put32(st, string_offset(strs, p->name));
+        buf_put(st, p->data, p->len);
+        buf_align(st);
+    }
+    for (struct node *c = n->children; c; c = c->next)
+        flatten(c, st, strs);
+    buf_put32(st, FDT_END_NODE);
+}
+
+static int write_blob(struct node *root, const char *path) {
+    struct buf st = { 0 }, strs = { 0 };
+    struct fdt_header hdr;
+    uint32_t rsv[4] = { 0 };
+    uint32_t off_rsv = sizeof(hdr), off_st = off_rsv + sizeof(rsv);
+    FILE *f;
+    int ret = 0;
+
+    flatten(root, &st, &strs);
+    buf_put32(&st, FDT_END);
+
+    hdr.magic = htonl(FDT_MAGIC);
+    hdr.totalsize = htonl(off_st + st.len + strs.len);
+    hdr.off_dt_struct = htonl(off_st);
+    hdr.off_dt_strings = htonl(off_st + st.len);
+    hdr.off_mem_rsvmap = htonl(off_rsv);
+    hdr.version = htonl(17);
+    hdr.last_comp_version = htonl(16);
+    hdr.boot_cpuid_phys = 0;
+    hdr.size_dt_strings = htonl(strs.len);
+    hdr.size_dt_struct = htonl(st.len);
+
+    f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    fwrite(&hdr, sizeof(hdr), 1, f);
+    fwrite(rsv, sizeof(rsv), 1, f);
+    fwrite(st.data, st.len, 1, f);
+    if (strs.len)
+        fwrite(strs.data, strs.len, 1, f);
+    if (fclose(f) != 0) {
+        perror(path);
+        ret = -1;
+    }
+    free(st.data);
+    free(strs.data);
+    return ret;
+}
+
+static struct node *load_blob(const char *path) {
+    unsigned char *blob;
+    struct node *root;
+    long size;
+    FILE *f = fopen(path, "rb");
+
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    rewind(f);
+    blob = xmalloc(size);
+    if (size <= 0 || fread(blob, size, 1, f) != 1) {
+        fprintf(stderr, "%s: %s: read failed\n", prog, path);
+        fclose(f);
+        free(blob);
+        return NULL;
+    }
+    fclose(f);
+    root = parse_blob(blob, size, path);
+    free(blob);
+    return root;
+}
+
+// ---------------------------------------------------------------------------------------------
+// merging
+
+static struct node *find_child(struct node *n, const char *name) {
+    for (struct node *c = n->children; c; c = c->next)
+        if (strcmp(c->name, name) == 0)
+            return c;
+    return NULL;
+}
+
+static struct prop *find_prop(struct node *n, const char *name) {
+    for (struct prop *p = n->props; p; p = p->next)
+        if (strcmp(p->name, name) == 0)
+            return p;
+    return NULL;
+}
+
+static int is_special(const char *name) {
+    return !strcmp(name, "__fixups__") || !strcmp(name, "__local_fixups__") || !strcmp(name, "__symbols__");
+}
+
+static int is_phandle(const struct prop *p) {
+    return p->len == 4 && (!strcmp(p->name, "phandle") || !strcmp(p->name, "linux,phandle"));
+}
+
+static uint32_t max_phandle(struct node *n) {
+    uint32_t max = 0;
+
+    for (struct prop *p = n->props; p; p = p->next)
+        if (is_phandle(p) && get_be32(p->data) != 0xffffffff && get_be32(p->data) > max)
+            max = get_be32(p->data);
+    for (struct node *c = n->children; c; c = c->next) {
+        uint32_t m = max_phandle(c);
+        if (m > max)
+            max = m;
+    }
+    return max;
+}
+
+static void shift_phandles(struct node *n, uint32_t delta) {
+    for (struct prop *p = n->props; p; p = p->next)
+        if (is_phandle(p) && get_be32(p->data) != 0xffffffff)
+            put_be32(p->data, get_be32(p->data) + delta);
+    for (struct node *c = n->children; c; c = c->next)
+        shift_phandles(c, delta);
+}
+
+// __local_fixups__ mirrors the tree; each property lists the offsets of local phandle references
+// in the property of the same name.
+static int shift_local_refs(struct node *fix, struct node *n, uint32_t delta) {
+    for (struct prop *fp = fix->props; fp; fp = fp->next) {
+        struct prop *p = find_prop(n, fp->name);
+
+        if (!p || fp->len % 4)
+            return -1;
+        for (uint32_t i = 0; i < fp->len; i += 4) {
+            uint32_t off = get_be32(fp->data + i);
+            if (off + 4 > p->len)
+                return -1;
+            put_be32(p->data + off, get_be32(p->data + off) + delta);
+        }
+    }
+    for (struct node *fc = fix->children; fc; fc = fc->next) {
+        struct node *c = find_child(n, fc->name);
+        if (!c || shift_local_refs(fc, c, delta) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+struct rename {
+    const char *from, *to;
+};
+
+// "/fragment@0/__overlay__/x" -> "/fragment@3/__overlay__/x", also for "/fragment@0:target:0"
+static char *rename_path(const char *path, const struct rename *map, int nmap) {
+    const char *rest;
+    size_t len;
+    char *out;
+
+    if (path[0] != '/')
+        return xstrdup(path);
+    rest = strpbrk(path + 1, "/:");
+    if (!rest)
+        rest = path + strlen(path);
+    len = rest - path - 1;
+    for (int i = 0; i < nmap; i++) {
+        if (strlen(map[i].from) == len && strncmp(path + 1, map[i].from, len) == 0) {
+            out = xmalloc(strlen(map[i].to) + strlen(rest) + 2);
+            sprintf(out, "/%s%s", map[i].to, rest);
+            return out;
+        }
+    }
+    return xstrdup(path);
+}
+
+// __fixups__ values are string lists of "path:property:offset"
+static void append_fixups(struct node *dst, struct prop *src, const struct rename *map, int nmap) {
+    struct prop *p = find_prop(dst, src->name);
+    struct buf b = { 0 };
+
+    if (p)
+        buf_put(&b, p->data, p->len);
+    for (uint32_t off = 0; off < src->len; off += strlen((char *)src->data + off) + 1) {
+        char *s = rename_path((char *)src->data + off, map, nmap);
+        buf_put(&b, s, strlen(s) + 1);
+        free(s);
+    }
+    if (p) {
+        free(p->data);
+        p->data = b.data;
+        p->len = b.len;
+    } else {
+        add_prop(dst, src->name, b.data, b.len);
+        free(b.data);
+    }
+}
+
+static int merge_overlay(struct node *out, struct node *ov, const char *path, uint32_t *phandle_base, int *nfrag) {
+    struct node *fixups = find_child(ov, "__fixups__");
+    struct node *local = find_child(ov, "__local_fixups__");
+    struct node *symbols = find_child(ov, "__symbols__");
+    struct rename map[256];
+    uint32_t delta = *phandle_base;
+    int nmap = 0;
+
+    // phandles: shift everything local past what is already in the output
+    if (local && delta && shift_local_refs(local, ov, delta) != 0) {
+        fprintf(stderr, "%s: %s: __local_fixups__ does not match the tree\n", prog, path);
+        return -1;
+    }
+    if (delta)
+        shift_phandles(ov, delta);
+    if (max_phandle(ov) > *phandle_base)
+        *phandle_base = max_phandle(ov);
+
+    // fragments: renumber and move to the output
+    for (struct node *c = ov->children, *next; c; c = next) {
+        char name[64], *at;
+
+        next = c->next;
+        if (is_special(c->name))
+            continue;
+        if (nmap == (int)(sizeof(map) / sizeof(map[0]))) {
+            fprintf(stderr, "%s: %s: too many fragments\n", prog, path);
+            return -1;
+        }
+        at = strchr(c->name, '@');
+        snprintf(name, sizeof(name), "%.*s@%d", at ? (int)(at - c->name) : (int)strlen(c->name), c->name, (*nfrag)++);
+        map[nmap].from = c->name;
+        map[nmap].to = xstrdup(name);
+        if (local) {
+            struct node *lc = find_child(local, c->name);
+            if (lc) {
+                // unlink first, add_child() ends the list at lc and would drop the later fragments
+                remove_child(local, lc);
+                lc->name = (char *)map[nmap].to;
+                add_child(find_child(out, "__local_fixups__"), lc);
+            }
+        }
+        c->name = (char *)map[nmap].to;
+        add_child(out, c);
+        nmap++;
+    }
+    // local fixup nodes not belonging to a fragment are left behind (there are none in practice)
+
+    if (fixups)
+        for (struct prop *p = fixups->props; p; p = p->next)
+            append_fixups(find_child(out, "__fixups__"), p, map, nmap);
+
+    if (symbols) {
+        struct node *out_sym = find_child(out, "__symbols__");
+        for (struct prop *p = symbols->props; p; p = p->next) {
+            char *s;
+
+            if (find_prop(out_sym, p->name)) {
+                fprintf(stderr, "%s: %s: duplicate symbol %s, keeping the first\n", prog, path, p->name);
+                continue;
+            }
+            s = rename_path((char *)p->data, map, nmap);
+            add_prop(out_sym, p->name, s, strlen(s) + 1);
+            free(s);
+        }
+    }
+    return 0;
+}
+
+static void usage(void) {
+    fprintf(stderr, "Usage: %s -o out.dtbo overlay.dtbo...\n", prog);
+    fprintf(stderr, "Merges device-tree overlays into one overlay, applied in the order given.\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *out_path = NULL;
+    struct node *out, *special[3];
+    uint32_t phandle_base = 0;
+    int nfrag = 0, opt;
+
+    prog = argv[0];
+    while ((opt = getopt(argc, argv, "o:h")) != -1) {
+        switch (opt) {
+            case 'o': out_path = optarg; break;
+            default:
+                usage();
+                return 1;
+        }
+    }
+    if (!out_path || optind >= argc) {
+        usage();
+        return 1;
+    }
+
+    out = xmalloc(sizeof(*out));
+    out->name = xstrdup("");
+    special[0] = xmalloc(sizeof(struct node));
+    special[0]->name = xstrdup("__symbols__");
+    special[1] = xmalloc(sizeof(struct node));
+    special[1]->name = xstrdup("__fixups__");
+    special[2] = xmalloc(sizeof(struct node));
+    special[2]->name = xstrdup("__local_fixups__");
+    for (int i = 0; i < 3; i++)
+        add_child(out, special[i]);
+
+    for (int i = optind; i < argc; i++) {
+        struct node *ov = load_blob(argv[i]);
+        if (!ov || merge_overlay(out, ov, argv[i], &phandle_base, &nfrag) != 0)
+            return 1;
+    }
+
+    // fragments first, then the special nodes that have content
+    for (int i = 0; i < 3; i++) {
+        struct node **pp = &out->children;
+        while (*pp != special[i])
+            pp = &(*pp)->next;
+        *pp = special[i]->next;
+        if (special[i]->props || special[i]->children)
+            add_child(out, special[i]);
+    }
+    return write_blob(out, out_path) == 0 ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+# Regression check for dtbo-merge: merges two overlays of two fragments each, where every fragment
+# references a node of the other one, and checks that all the references in the merged overlay
+# are listed in its __local_fixups__ and still point at the node they pointed at before.
+#
+# Usage: merge-local-fixups.py path/to/dtbo-merge
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+
+FDT_BEGIN_NODE, FDT_END_NODE, FDT_PROP, FDT_NOP, FDT_END = 1, 2, 3, 4, 9
+
+
+# a node is (name, [(prop, bytes)], [children])
+def cells(*v):
+    return struct.pack('>%dI' % len(v), *v)
+
+
+def string(s):
+    return s.encode() + b'\0'
+
+
+def write_blob(root, path):
+    st, strs, offsets = bytearray(), bytearray(), {}
+
+    def flatten(n):
+        name, props, children = n
+        st.extend(struct.pack('>I', FDT_BEGIN_NODE) + string(name))
+        st.extend(b'\0' * (-len(st) % 4))
+        for pname, data in props:
+            if pname not in offsets:
+                offsets[pname] = len(strs)
+                strs.extend(string(pname))
+            st.extend(struct.pack('>III', FDT_PROP, len(data), offsets[pname]) + data)
+            st.extend(b'\0' * (-len(st) % 4))
+        for c in children:
+            flatten(c)
+        st.extend(struct.pack('>I', FDT_END_NODE))
+
+    flatten(root)
+    st.extend(struct.pack('>I', FDT_END))
+    rsv = 40
+    off_st = rsv + 16
+    off_strs = off_st + len(st)
+    total = off_strs + len(strs)
+    hdr = struct.pack('>10I', 0xd00dfeed, total, off_st, off_strs, rsv, 17, 16, 0, len(strs), len(st))
+    with open(path, 'wb') as f:
+        f.write(hdr + b'\0' * 16 + bytes(st) + bytes(strs))
+
+
+def read_blob(path):
+    data = open(path, 'rb').read()
+    off_st, off_strs = struct.unpack('>II', data[8:16])
+    pos, stack, root = off_st, [], None
+    while True:
+        tok, = struct.unpack('>I', data[pos:pos + 4])
+        pos += 4
+        if tok == FDT_BEGIN_NODE:
+            end = data.index(b'\0', pos)
+            n = (data[pos:end].decode(), {}, {})
+            pos = (end + 4) & ~3
+            if stack:
+                stack[-1][2][n[0]] = n
+            else:
+                root = n
+            stack.append(n)
+        elif tok == FDT_END_NODE:
+            stack.pop()
+        elif tok == FDT_PROP:
+            length, nameoff = struct.unpack('>II', data[pos:pos + 8])
+            name = data[off_strs + nameoff:data.index(b'\0', off_strs + nameoff)].decode()
+            stack[-1][1][name] = data[pos + 8:pos + 8 + length]
+            pos = (pos + 8 + length + 3) & ~3
+        elif tok == FDT_END:
+            return root
+
+
+# two fragments, a in fragment@0 refers to b in fragment@1 and the other way round
+def overlay(tag):
+    return ('', [], [
+        ('fragment@0', [('target', cells(0xffffffff))], [
+            ('__overlay__', [], [
+                ('a-' + tag, [('phandle', cells(1)), ('peer', cells(2, 7))], []),
+            ]),
+        ]),
+        ('fragment@1', [('target', cells(0xffffffff))], [
+            ('__overlay__', [], [
+                ('b-' + tag, [('phandle', cells(2)), ('peer', cells(1))], []),
+            ]),
+        ]),
+        ('__fixups__', [('i2c', string('/fragment@0:target:0') + string('/fragment@1:target:0'))], []),
+        ('__local_fixups__', [], [
+            ('fragment@0', [], [('__overlay__', [], [('a-' + tag, [('peer', cells(0))], [])])]),
+            ('fragment@1', [], [('__overlay__', [], [('b-' + tag, [('peer', cells(0))], [])])]),
+        ]),
+    ])
+
+
+def main():
+    merge = sys.argv[1]
+    with tempfile.TemporaryDirectory() as tmp:
+        inputs = []
+        for tag in ('x', 'y'):
+            inputs.append(os.path.join(tmp, tag + '.dtbo'))
+            write_blob(overlay(tag), inputs[-1])
+        out = os.path.join(tmp, 'merged.dtbo')
+        subprocess.run([merge, '-o', out] + inputs, check=True)
+        root = read_blob(out)
+
+    errors = []
+    frags = sorted(n for n in root[2] if n.startswith('fragment@'))
+    local = root[2]['__local_fixups__'][2]
+    if sorted(local) != frags:
+        errors.append('__local_fixups__ has %s, expected %s' % (sorted(local), frags))
+
+    # every node by phandle, and every local reference listed in __local_fixups__
+    nodes = {}
+    for f in frags:
+        for name, n in root[2][f][2]['__overlay__'][2].items():
+            nodes[struct.unpack('>I', n[1]['phandle'])[0]] = name
+    for f in frags:
+        for name, n in root[2][f][2]['__overlay__'][2].items():
+            fix = local.get(f, ('', {}, {}))[2].get('__overlay__', ('', {}, {}))[2].get(name)
+            if not fix:
+                errors.append('%s/%s: no local fixup' % (f, name))
+                continue
+            ref = struct.unpack('>I', n[1]['peer'][:4])[0]
+            expected = ('b-' if name.startswith('a-') else 'a-') + name[2:]
+            if nodes.get(ref) != expected:
+                errors.append('%s/%s: peer points at %s, expected %s' % (f, name, nodes.get(ref), expected))
+
+    for e in errors:
+        print('FAIL:', e)
+    if not errors:
+        print('ok: %d fragments, local fixups and references intact' % len(frags))
+    return 1 if errors else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -56,6 +56,13 @@ static struct resolution sensor_res_list[] = {
 	{.width = 1920, .height = 1080, .framerate = 60, .reg_val = 0x92 },    // 1080p60
 };
 
+/* mode changes are announced on the subdev devnode, u.data[0] = reg_val. Handled by crosslink-moded. */
+#define CROSSLINK_EVENT_MODE	(V4L2_EVENT_PRIVATE_START + 1)
+
+static bool mode_upcall;
+module_param(mode_upcall, bool, 0644);
+MODULE_PARM_DESC(mode_upcall, "Also run /bin/crosslink_cs1_res.sh on mode changes (legacy, default off)");
+
 #define SERIAL_BAUDRATE 9600
 struct crosslink_ioctl_serial {
 	u32 tx_len;
@@ -131,6 +138,16 @@ static int crosslink_resolution_upcall(struct crosslink_dev *sensor, int resolut
 	return 0;
 }
 
+static void crosslink_queue_mode_event(struct crosslink_dev *sensor, int resolution)
+{
+	struct v4l2_event ev = { .type = CROSSLINK_EVENT_MODE };
+
+	if (!sensor->sd.devnode)
+		return;
+	ev.u.data[0] = resolution;
+	v4l2_event_queue(sensor->sd.devnode, &ev);
+}
+
 static void crosslink_power(struct crosslink_dev *sensor, int enable)
 {
 	dev_dbg(sensor->dev, "setting reset pin: %s\n", enable ? "ON" : "OFF");
@@ -198,7 +215,7 @@ static int crosslink_serial_tx_upcall(struct crosslink_dev *sensor, struct cross
 	char *envp[] = { "HOME=/", "PATH=/sbin:/bin:/usr/sbin:/usr/bin", NULL };
 
 	bin2hex(data, serial->tx_data, serial->tx_len);
-	snprintf(cmd, sizeof(cmd), "/usr/bin/serial-xfer %s %s %s %d %d > /tmp/%s_out", baud, tty, data, serial->timeout_ms, serial->rx_wait_count, sensor->of_name);
+	snprintf(cmd, sizeof(cmd), "/usr/bin/serial-xfer -b %s %s %s %d %d > /tmp/%s_out", baud, tty, data, serial->timeout_ms, serial->rx_wait_count, sensor->of_name);
 	argv[2] = cmd;
 
 	dev_dbg_ratelimited(sensor->dev, "%s: \n", __func__);
@@ -209,7 +226,6 @@ static int crosslink_serial_tx_upcall(struct crosslink_dev *sensor, struct cross
 static int crosslink_serial_rx_read(struct crosslink_dev *sensor, struct crosslink_ioctl_serial *serial)
 {
 	char path[128];
-	char data[128];
 	struct file *filp = NULL;
 	ssize_t nbytes = 0;
 	int retval = 0;
@@ -222,14 +238,14 @@ static int crosslink_serial_rx_read(struct crosslink_dev *sensor, struct crossli
 		retval = PTR_ERR(filp);
 	}
 	else {
-		nbytes = kernel_read(filp, &data, sizeof(data), 0);
+		// serial-xfer -b writes the raw response bytes, no hex conversion needed.
+		nbytes = kernel_read(filp, serial->rx_data, sizeof(serial->rx_data), 0);
 		if (nbytes < 0) {
 			pr_err("%s read %s file fail nbytes=%ld!\n", __func__, path, (long)nbytes);
 			retval = -EIO;
 		}
 		else {
-			hex2bin(serial->rx_data, data, nbytes);
-			serial->rx_len = nbytes>>1;
+			serial->rx_len = nbytes;
 			retval = 0;
 		}
 		filp_close(filp, NULL);
@@ -355,7 +371,10 @@ static int crosslink_set_fmt(struct v4l2_subdev *sd, struct v4l2_subdev_state *s
 
 	// if ((new_mode != sensor->mode) && (format->which != V4L2_SUBDEV_FORMAT_TRY)) {
 	sensor->mode = new_mode;
-	ret |= crosslink_resolution_upcall(sensor, new_mode->reg_val);
+	if (format->which != V4L2_SUBDEV_FORMAT_TRY)
+		crosslink_queue_mode_event(sensor, new_mode->reg_val);
+	if (mode_upcall)
+		ret |= crosslink_resolution_upcall(sensor, new_mode->reg_val);
 
 	pr_debug("%s: sensor->ep.bus_type =%d\n", __func__, sensor->ep.bus_type);
 	pr_debug("%s: sensor->ep.bus      =%p\n", __func__, &sensor->ep.bus);
@@ -535,10 +554,17 @@ exit:
 }
 
 
+static int crosslink_subscribe_event(struct v4l2_subdev *sd, struct v4l2_fh *fh, struct v4l2_event_subscription *sub)
+{
+	if (sub->type == CROSSLINK_EVENT_MODE)
+		return v4l2_event_subscribe(fh, sub, 4, NULL);
+	return v4l2_ctrl_subdev_subscribe_event(sd, fh, sub);
+}
+
 static const struct v4l2_subdev_core_ops crosslink_core_ops = {
 	.s_power = crosslink_s_power,
 	.log_status = v4l2_ctrl_subdev_log_status,
-	.subscribe_event = v4l2_ctrl_subdev_subscribe_event,
+	.subscribe_event = crosslink_subscribe_event,
 	.unsubscribe_event = v4l2_event_subdev_unsubscribe,
 	.ioctl = crosslink_ioctl,
 };
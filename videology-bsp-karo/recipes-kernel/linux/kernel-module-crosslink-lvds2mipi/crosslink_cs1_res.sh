@@ -4,8 +4,10 @@
 # 1: i2c-to-uart inside the crosslink to take care of visca.
 # 2: a serdev v4l2 subdev driver which chains with the crosslink one.
 # 3: at least a V4L2_EVENT_SOURCE_CHANGE event chnage listener in userspace to replace this script.
+# Option 3 is crosslink-moded (serial-xfer recipe). This script only runs when the module is loaded with mode_upcall=1.
 
 port="/dev/ttymxc3"
+bridge="/dev/links/csi1_i2c@0x1c"
 
 log=/home/root/lvds2mipi_log.txt
 has_i2c_serial=""
@@ -13,7 +15,7 @@ has_i2c_serial=""
 function write_check() {
     for l in {0..20}; do
         if [[ -n "${has_i2c_serial}" ]]; then
-            res=$(crosslink-i2c-serial.py xfer "$1")
+            res=$(serial-xfer --i2c-bridge "$bridge" "$1")
         else
             res=$(serial-xfer 9600 "$port" "$1")
         fi
@@ -81,7 +83,7 @@ fi
 
 # check if Sony or Not
 if [[ -n "${has_i2c_serial}" ]]; then
-    res=$(crosslink-i2c-serial.py xfer "81090002FF")
+    res=$(serial-xfer --i2c-bridge "$bridge" "81090002FF")
 else
     res=$(serial-xfer 9600 "$port" "81090002FF")
 fi
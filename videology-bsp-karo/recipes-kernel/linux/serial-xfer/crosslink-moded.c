@@ -0,0 +1,514 @@
+// SPDX-License-Identifier: MIT
+// crosslink mode-change daemon. Replaces the crosslink_cs1_res.sh upcall: listens for
+// CROSSLINK_EVENT_MODE on the crosslink subdev, detects the camera model once, and sends
+// only the VISCA commands that differ from the last applied mode.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <limits.h>
+#include <poll.h>
+#include <getopt.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <linux/videodev2.h>
+#include <linux/v4l2-subdev.h>
+
+#include "serial-xfer.h"
+
+// must match crosslink-cam.c. u.data[0] is the mode's reg_val.
+#define CROSSLINK_EVENT_MODE    (V4L2_EVENT_PRIVATE_START + 1)
+
+#define DEFAULT_CONFIG          "/etc/crosslink-moded.conf"
+#define DEFAULT_BAUD            9600
+#define DEFAULT_RETRIES         20
+#define MAX_MODELS              8
+#define MAX_MODES               64
+#define MAX_CMDS                8
+#define MAX_POLLS               4
+#define MAX_CMD_LEN             32
+#define IDENTIFY_CMD            "81090002FF"   // CAM_VersionInq
+
+// must match sensor_res_list in crosslink-cam.c, to find the mode the driver is in at startup
+static const struct {
+    int width, height, framerate, reg_val;
+} driver_modes[] = {
+    { 1280,  720, 25, 0x03 }, { 1280,  720, 30, 0x02 }, { 1280,  720, 50, 0x01 }, { 1280,  720, 60, 0x00 },
+    { 1920, 1080, 25, 0x13 }, { 1920, 1080, 30, 0x12 }, { 1920, 1080, 50, 0x93 }, { 1920, 1080, 60, 0x92 },
+};
+
+struct visca_cmd {
+    unsigned char data[MAX_CMD_LEN];
+    int len;
+    int always;     // send even if the previous mode sent the same command (e.g. a reset)
+};
+
+struct mode {
+    int model;
+    int reg_val;
+    struct visca_cmd cmds[MAX_CMDS];
+    int ncmds;
+};
+
+struct poll_cmd {
+    struct visca_cmd cmd;
+    char expect[2 * MAX_CMD_LEN + 1];
+    int tries;
+};
+
+struct model {
+    char name[32];
+    char id[2 * MAX_CMD_LEN + 1];   // hex substring of the IDENTIFY_CMD reply
+    struct poll_cmd polls[MAX_POLLS];
+    int npolls;
+};
+
+static struct config {
+    char port[128];
+    int baud;
+    char bridge[128];
+    char ack[2 * MAX_CMD_LEN + 1];
+    int retries;
+    struct model models[MAX_MODELS];
+    int nmodels;
+    struct mode modes[MAX_MODES];
+    int nmodes;
+} cfg;
+
+static struct cam_link {
+    int fd;                 // tty, when not using the bridge
+    struct i2c_bridge br;
+    FILE *replay;           // recorded replies, one hex line per command
+} cam_link = { .fd = -1, .br = { .fd = -1 } };
+
+static int cur_model = -1;              // cached detected model
+static const struct mode *cur_mode;     // last applied mode
+
+static int find_model(const char *name) {
+    for (int i = 0; i < cfg.nmodels; i++)
+        if (strcmp(cfg.models[i].name, name) == 0)
+            return i;
+    return -1;
+}
+
+static int parse_cmd(const char *tok, struct visca_cmd *cmd, int lineno) {
+    cmd->always = (*tok == '!');
+    cmd->len = parse_hex(tok + cmd->always, cmd->data, sizeof(cmd->data));
+    if (cmd->len < 0) {
+        fprintf(stderr, "config line %d: bad command '%s'\n", lineno, tok);
+        return -1;
+    }
+    return 0;
+}
+
+// Config format, one statement per line, '#' starts a comment:
+//   port <tty> [baud]
+//   bridge <i2c-device>[@addr]          used instead of port when the board has the i2c uart
+//   ack <hex>                           reply substring that counts as success (default 9041FF)
+//   retries <n>
+//   model <name> <hex-id>               model is detected when the IDENTIFY_CMD reply contains hex-id
+//   mode <model> <reg_val> <cmd>...     commands for a mode. '!' prefix: always send
+//   poll <model> <cmd> <expect> <tries> sent after each mode change until the reply contains expect
+static int load_config(const char *path) {
+    char *line = NULL, *tok, *save;
+    size_t line_size = 0;
+    int lineno = 0, ret = 0;
+    FILE *f = fopen(path, "r");
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    cfg.baud = DEFAULT_BAUD;
+    cfg.retries = DEFAULT_RETRIES;
+    strcpy(cfg.ack, "9041FF");
+
+    while (ret == 0 && getline(&line, &line_size, f) != -1) {
+        char *hash = strchr(line, '#');
+        lineno++;
+        if (hash)
+            *hash = '\0';
+        tok = strtok_r(line, " \t\r\n", &save);
+        if (!tok)
+            continue;
+
+        if (strcmp(tok, "port") == 0 && (tok = strtok_r(NULL, " \t\r\n", &save))) {
+            snprintf(cfg.port, sizeof(cfg.port), "%s", tok);
+            if ((tok = strtok_r(NULL, " \t\r\n", &save)))
+                cfg.baud = atoi(tok);
+        } else if (strcmp(tok, "bridge") == 0 && (tok = strtok_r(NULL, " \t\r\n", &save))) {
+            snprintf(cfg.bridge, sizeof(cfg.bridge), "%s", tok);
+        } else if (strcmp(tok, "ack") == 0 && (tok = strtok_r(NULL, " \t\r\n", &save))) {
+            snprintf(cfg.ack, sizeof(cfg.ack), "%s", tok);
+        } else if (strcmp(tok, "retries") == 0 && (tok = strtok_r(NULL, " \t\r\n", &save))) {
+            cfg.retries = atoi(tok);
+        } else if (strcmp(tok, "model") == 0) {
+            char *name = strtok_r(NULL, " \t\r\n", &save);
+            char *id = strtok_r(NULL, " \t\r\n", &save);
+            if (!name || !id || cfg.nmodels >= MAX_MODELS) {
+                fprintf(stderr, "config line %d: expected 'model <name> <hex-id>'\n", lineno);
+                ret = -1;
+                continue;
+            }
+            struct model *m = &cfg.models[cfg.nmodels++];
+            snprintf(m->name, sizeof(m->name), "%s", name);
+            snprintf(m->id, sizeof(m->id), "%s", id);
+        } else if (strcmp(tok, "mode") == 0) {
+            char *name = strtok_r(NULL, " \t\r\n", &save);
+            char *val = strtok_r(NULL, " \t\r\n", &save);
+            int model = name ? find_model(name) : -1;
+            if (model < 0 || !val || cfg.nmodes >= MAX_MODES) {
+                fprintf(stderr, "config line %d: expected 'mode <known model> <reg_val> <cmd>...'\n", lineno);
+                ret = -1;
+                continue;
+            }
+            struct mode *md = &cfg.modes[cfg.nmodes++];
+            md->model = model;
+            md->reg_val = strtol(val, NULL, 0);
+            while (ret == 0 && (tok = strtok_r(NULL, " \t\r\n", &save))) {
+                if (md->ncmds >= MAX_CMDS) {
+                    fprintf(stderr, "config line %d: too many commands, max %d\n", lineno, MAX_CMDS);
+                    ret = -1;
+                } else {
+                    ret = parse_cmd(tok, &md->cmds[md->ncmds++], lineno);
+                }
+            }
+        } else if (strcmp(tok, "poll") == 0) {
+            char *name = strtok_r(NULL, " \t\r\n", &save);
+            char *cmd = strtok_r(NULL, " \t\r\n", &save);
+            char *expect = strtok_r(NULL, " \t\r\n", &save);
+            char *tries = strtok_r(NULL, " \t\r\n", &save);
+            int model = name ? find_model(name) : -1;
+            if (model < 0 || !tries || cfg.models[model].npolls >= MAX_POLLS) {
+                fprintf(stderr, "config line %d: expected 'poll <known model> <cmd> <expect> <tries>'\n", lineno);
+                ret = -1;
+                continue;
+            }
+            struct poll_cmd *p = &cfg.models[model].polls[cfg.models[model].npolls++];
+            ret = parse_cmd(cmd, &p->cmd, lineno);
+            snprintf(p->expect, sizeof(p->expect), "%s", expect);
+            p->tries = atoi(tries);
+        } else {
+            fprintf(stderr, "config line %d: unknown statement '%s'\n", lineno, tok);
+            ret = -1;
+        }
+    }
+    free(line);
+    fclose(f);
+    return ret;
+}
+
+static int link_open(void) {
+    struct serial_opts opts = { .baud = cfg.baud };
+
+    if (cam_link.replay)
+        return 0;
+    if (cfg.bridge[0] && i2c_bridge_open(cfg.bridge, &cam_link.br) == 0) {
+        if (i2c_bridge_present(&cam_link.br)) {
+            fprintf(stderr, "using i2c uart bridge %s\n", cfg.bridge);
+            return 0;
+        }
+        i2c_bridge_close(&cam_link.br);
+    }
+    if (!cfg.port[0]) {
+        fprintf(stderr, "no usable port or bridge configured\n");
+        return -1;
+    }
+    cam_link.fd = open(cfg.port, O_RDWR | O_NOCTTY | O_SYNC);
+    if (cam_link.fd < 0) {
+        perror(cfg.port);
+        return -1;
+    }
+    if (setup_serial(cam_link.fd, &opts) != 0)
+        return -1;
+    fprintf(stderr, "using %s at %d baud\n", cfg.port, cfg.baud);
+    return 0;
+}
+
+// Send one command and return the reply as an uppercase hex string.
+static int link_xfer(const struct visca_cmd *cmd, char *hex, int hex_size) {
+    static const char digits[] = "0123456789ABCDEF";
+    unsigned char rx[MAX_CMD_LEN];
+    int n;
+
+    if (cam_link.replay) {
+        char *line = NULL;
+        size_t line_size = 0;
+        // log the command, take the recorded reply
+        for (int i = 0; i < cmd->len; i++)
+            printf("%02X", cmd->data[i]);
+        printf("\n");
+        fflush(stdout);
+        n = 0;
+        if (getline(&line, &line_size, cam_link.replay) != -1) {
+            line[strcspn(line, " \t\r\n")] = '\0';
+            if (line[0])
+                n = parse_hex(line, rx, sizeof(rx));
+        }
+        free(line);
+    } else if (cam_link.br.fd >= 0) {
+        n = i2c_bridge_xfer(&cam_link.br, cmd->data, cmd->len, DEFAULT_TIMEOUT, 0, rx, sizeof(rx));
+    } else {
+        flush_rx_buffer(cam_link.fd);
+        n = -1;
+        if (send_data(cam_link.fd, cmd->data, cmd->len) > 0) {
+            tcdrain(cam_link.fd);
+            n = recv_data(cam_link.fd, DEFAULT_TIMEOUT, 0, rx, sizeof(rx));
+        }
+    }
+    if (n < 0)
+        n = 0;
+    if (n > (hex_size - 1) / 2)
+        n = (hex_size - 1) / 2;
+    for (int i = 0; i < n; i++) {
+        hex[2*i]     = digits[rx[i] >> 4];
+        hex[2*i + 1] = digits[rx[i] & 0xF];
+    }
+    hex[2 * n] = '\0';
+    return n;
+}
+
+// Send a command until the reply contains expect, like write_check() in crosslink_cs1_res.sh
+static int xfer_check(const struct visca_cmd *cmd, const char *expect, int tries) {
+    char reply[2 * MAX_CMD_LEN + 1];
+
+    for (int i = 0; i < tries; i++) {
+        link_xfer(cmd, reply, sizeof(reply));
+        if (strstr(reply, expect))
+            return 0;
+        usleep(100000);
+    }
+    return -1;
+}
+
+static int detect_model(void) {
+    struct visca_cmd id = { .len = 0 };
+    char reply[2 * MAX_CMD_LEN + 1];
+
+    id.len = parse_hex(IDENTIFY_CMD, id.data, sizeof(id.data));
+    link_xfer(&id, reply, sizeof(reply));
+    for (int i = 0; i < cfg.nmodels; i++) {
+        if (strstr(reply, cfg.models[i].id)) {
+            fprintf(stderr, "detected camera: %s (%s)\n", cfg.models[i].name, reply);
+            return i;
+        }
+    }
+    fprintf(stderr, "Unknown camera (%s)\n", reply);
+    return -1;
+}
+
+static int sent_by(const struct mode *md, const struct visca_cmd *cmd) {
+    if (!md)
+        return 0;
+    for (int i = 0; i < md->ncmds; i++)
+        if (md->cmds[i].len == cmd->len && memcmp(md->cmds[i].data, cmd->data, cmd->len) == 0)
+            return 1;
+    return 0;
+}
+
+static void apply_mode(int reg_val) {
+    const struct mode *md = NULL;
+    int sent = 0, failed = 0;
+
+    if (cur_model < 0) {
+        cur_model = detect_model();
+        cur_mode = NULL;
+        if (cur_model < 0)
+            return;
+    }
+    for (int i = 0; i < cfg.nmodes; i++)
+        if (cfg.modes[i].model == cur_model && cfg.modes[i].reg_val == reg_val)
+            md = &cfg.modes[i];
+    if (!md) {
+        fprintf(stderr, "%s: no mode 0x%02x in config\n", cfg.models[cur_model].name, reg_val);
+        return;
+    }
+    if (md == cur_mode) {
+        fprintf(stderr, "%s: mode 0x%02x already applied\n", cfg.models[cur_model].name, reg_val);
+        return;
+    }
+
+    for (int i = 0; i < md->ncmds; i++) {
+        if (!md->cmds[i].always && sent_by(cur_mode, &md->cmds[i]))
+            continue;
+        if (xfer_check(&md->cmds[i], cfg.ack, cfg.retries) != 0)
+            failed = 1;
+        sent++;
+    }
+    for (int i = 0; i < cfg.models[cur_model].npolls; i++) {
+        const struct poll_cmd *p = &cfg.models[cur_model].polls[i];
+        xfer_check(&p->cmd, p->expect, p->tries);
+    }
+
+    if (failed) {
+        // camera may have been swapped or lost power: detect again on the next event
+        fprintf(stderr, "%s: mode 0x%02x failed, no ack\n", cfg.models[cur_model].name, reg_val);
+        cur_model = -1;
+        cur_mode = NULL;
+        return;
+    }
+    fprintf(stderr, "%s: mode 0x%02x applied, %d of %d commands sent\n", cfg.models[cur_model].name, reg_val, sent, md->ncmds);
+    cur_mode = md;
+}
+
+// First v4l-subdev whose name starts with "crosslink"
+static int find_subdev(char *path, int size) {
+    struct dirent *de;
+    DIR *d = opendir("/sys/class/video4linux");
+    int ret = -1;
+
+    if (!d)
+        return -1;
+    while (ret && (de = readdir(d))) {
+        char name_path[300], name[64] = "";
+        FILE *f;
+        if (strncmp(de->d_name, "v4l-subdev", 10) != 0)
+            continue;
+        snprintf(name_path, sizeof(name_path), "/sys/class/video4linux/%s/name", de->d_name);
+        f = fopen(name_path, "r");
+        if (!f)
+            continue;
+        if (fgets(name, sizeof(name), f) && strncmp(name, "crosslink", 9) == 0) {
+            snprintf(path, size, "/dev/%s", de->d_name);
+            ret = 0;
+        }
+        fclose(f);
+    }
+    closedir(d);
+    return ret;
+}
+
+// reg_val of the format the subdev is set to now, -1 if it is not one of driver_modes
+static int current_mode(int fd) {
+    struct v4l2_subdev_format fmt = { .which = V4L2_SUBDEV_FORMAT_ACTIVE };
+    struct v4l2_subdev_frame_interval fi = { 0 };
+
+    if (ioctl(fd, VIDIOC_SUBDEV_G_FMT, &fmt) != 0) {
+        perror("VIDIOC_SUBDEV_G_FMT");
+        return -1;
+    }
+    if (ioctl(fd, VIDIOC_SUBDEV_G_FRAME_INTERVAL, &fi) != 0 || !fi.interval.numerator) {
+        perror("VIDIOC_SUBDEV_G_FRAME_INTERVAL");
+        return -1;
+    }
+    for (size_t i = 0; i < sizeof(driver_modes) / sizeof(driver_modes[0]); i++)
+        if (driver_modes[i].width == (int)fmt.format.width && driver_modes[i].height == (int)fmt.format.height &&
+            driver_modes[i].framerate == (int)(fi.interval.denominator / fi.interval.numerator))
+            return driver_modes[i].reg_val;
+    fprintf(stderr, "current format %ux%u@%u/%u is not a known mode\n", fmt.format.width, fmt.format.height,
+            fi.interval.denominator, fi.interval.numerator);
+    return -1;
+}
+
+static int run_events(const char *devnode) {
+    struct v4l2_event_subscription sub = { .type = CROSSLINK_EVENT_MODE };
+    struct pollfd pfd;
+    int fd = open(devnode, O_RDWR | O_NONBLOCK);
+
+    if (fd < 0) {
+        perror(devnode);
+        return 1;
+    }
+    if (ioctl(fd, VIDIOC_SUBSCRIBE_EVENT, &sub) != 0) {
+        perror("VIDIOC_SUBSCRIBE_EVENT");
+        close(fd);
+        return 1;
+    }
+    fprintf(stderr, "listening for mode changes on %s\n", devnode);
+
+    // changes made before the subscription sent no event we can see, start from the current mode
+    int initial = current_mode(fd);
+    if (initial >= 0)
+        apply_mode(initial);
+
+    pfd.fd = fd;
+    pfd.events = POLLPRI;
+    while (1) {
+        struct v4l2_event ev;
+
+        if (poll(&pfd, 1, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            break;
+        }
+        // only the newest pending mode matters, apply once after draining the queue.
+        int reg_val = -1;
+        while (ioctl(fd, VIDIOC_DQEVENT, &ev) == 0)
+            if (ev.type == CROSSLINK_EVENT_MODE)
+                reg_val = ev.u.data[0];
+        if (reg_val >= 0)
+            apply_mode(reg_val);
+    }
+    close(fd);
+    return 1;
+}
+
+// Replay: modes come from stdin, one reg_val per line, replies from a recorded file.
+static int run_replay(void) {
+    char line[64];
+
+    while (fgets(line, sizeof(line), stdin)) {
+        char *end;
+        long reg_val = strtol(line, &end, 0);
+        if (end != line)
+            apply_mode(reg_val);
+    }
+    return 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-c config] [-d v4l-subdev] [-r replies]\n", prog);
+    fprintf(stderr, "Applies VISCA mode changes requested by the crosslink driver.\n");
+    fprintf(stderr, "  -c, --config FILE   mode table (default %s)\n", DEFAULT_CONFIG);
+    fprintf(stderr, "  -d, --device DEV    crosslink subdev (default: first v4l-subdev named crosslink*)\n");
+    fprintf(stderr, "  -r, --replay FILE   no hardware: read modes from stdin, take camera replies from FILE\n");
+    fprintf(stderr, "                      (one hex reply per line) and print the commands that would be sent\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *config = DEFAULT_CONFIG;
+    char devnode[PATH_MAX] = "";
+    int opt;
+
+    static const struct option long_opts[] = {
+        { "config", required_argument, NULL, 'c' },
+        { "device", required_argument, NULL, 'd' },
+        { "replay", required_argument, NULL, 'r' },
+        { "help",   no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    while ((opt = getopt_long(argc, argv, "c:d:r:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+            case 'c': config = optarg; break;
+            case 'd': snprintf(devnode, sizeof(devnode), "%s", optarg); break;
+            case 'r':
+                cam_link.replay = fopen(optarg, "r");
+                if (!cam_link.replay) {
+                    perror(optarg);
+                    return 1;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (cam_link.replay)
+        return load_config(config) != 0 || link_open() != 0 ? 1 : run_replay();
+
+    // look for the camera first, boards without one must not touch the port
+    if (!devnode[0] && find_subdev(devnode, sizeof(devnode)) != 0) {
+        // not an error: most boards have no crosslink camera
+        fprintf(stderr, "no crosslink subdev found\n");
+        return 0;
+    }
+    if (load_config(config) != 0 || link_open() != 0)
+        return 1;
+    return run_events(devnode);
+}
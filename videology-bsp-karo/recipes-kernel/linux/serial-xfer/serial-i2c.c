@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: MIT
+// I2C-to-UART bridge transport for the crosslink lvds2mipi FPGA. Replaces crosslink-i2c-serial.py.
+// Register map matches enum crosslink_regs in crosslink-cam.c.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+#include "serial-xfer.h"
+
+#define DEFAULT_BRIDGE_ADDR     0x1c
+#define BRIDGE_FIFO_SIZE        32      // UART RX/TX fifos are 32 bytes deep
+#define BRIDGE_POLL_US          1000    // ~1 byte time at 9600 baud
+
+enum crosslink_regs {
+    CROSSLINK_REG_UART_STAT = 0x9,      // board_detect2 & board_detect1 & busy_tx & busy_rx & fulltx & emptytx & fullrx & emptyrx
+    CROSSLINK_REG_UART_RX_CNT = 0xA,    // count of bytes in UART RX fifo
+    CROSSLINK_REG_SERIAL = 0x80,        // reads/writes here go to the UART RX/TX fifos
+};
+
+#define UART_STAT_BOARD_DETECT  (3 << 6)
+#define UART_STAT_BUSY_TX       (1 << 5)
+#define UART_STAT_EMPTY_TX      (1 << 2)
+
+static long long time_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Open a bridge from a "device[@addr]" spec, e.g. /dev/links/csi1_i2c@0x1c
+int i2c_bridge_open(const char *spec, struct i2c_bridge *br) {
+    const char *at = strrchr(spec, '@');
+    char dev[128];
+
+    snprintf(dev, sizeof(dev), "%.*s", at ? (int)(at - spec) : (int)strlen(spec), spec);
+    br->addr = at ? strtol(at + 1, NULL, 0) : DEFAULT_BRIDGE_ADDR;
+    if (br->addr <= 0 || br->addr > 0x7f) {
+        fprintf(stderr, "invalid i2c address: %s\n", spec);
+        return -1;
+    }
+    br->fd = open(dev, O_RDWR);
+    if (br->fd < 0) {
+        perror(dev);
+        return -1;
+    }
+    return 0;
+}
+
+void i2c_bridge_close(struct i2c_bridge *br) {
+    if (br->fd >= 0)
+        close(br->fd);
+    br->fd = -1;
+}
+
+// read len bytes starting at reg, in one combined I2C_RDWR transaction
+static int bridge_read(struct i2c_bridge *br, unsigned char reg, unsigned char *buf, int len) {
+    struct i2c_msg msgs[2] = {
+        { .addr = br->addr, .flags = 0,        .len = 1,   .buf = &reg },
+        { .addr = br->addr, .flags = I2C_M_RD, .len = len, .buf = buf },
+    };
+    struct i2c_rdwr_ioctl_data data = { .msgs = msgs, .nmsgs = 2 };
+
+    if (ioctl(br->fd, I2C_RDWR, &data) < 0) {
+        perror("ioctl I2C_RDWR");
+        return -1;
+    }
+    return len;
+}
+
+static int bridge_write_fifo(struct i2c_bridge *br, const unsigned char *data, int len) {
+    unsigned char buf[1 + BRIDGE_FIFO_SIZE];
+    struct i2c_msg msg = { .addr = br->addr, .flags = 0, .len = len + 1, .buf = buf };
+    struct i2c_rdwr_ioctl_data rdwr = { .msgs = &msg, .nmsgs = 1 };
+
+    buf[0] = CROSSLINK_REG_SERIAL;
+    memcpy(buf + 1, data, len);
+    if (ioctl(br->fd, I2C_RDWR, &rdwr) < 0) {
+        perror("ioctl I2C_RDWR");
+        return -1;
+    }
+    return len;
+}
+
+// Read whatever is in the RX fifo: one RX_CNT read, then one burst read of exactly that many bytes.
+static int bridge_read_fifo(struct i2c_bridge *br, unsigned char *buf, int buf_size) {
+    unsigned char cnt;
+
+    if (bridge_read(br, CROSSLINK_REG_UART_RX_CNT, &cnt, 1) < 0)
+        return -1;
+    if (cnt > buf_size)
+        cnt = buf_size;
+    if (cnt == 0)
+        return 0;
+    return bridge_read(br, CROSSLINK_REG_SERIAL, buf, cnt);
+}
+
+// Check the board_detect bits, set on crosslink board revisions with the I2C-to-UART bridge.
+int i2c_bridge_present(struct i2c_bridge *br) {
+    unsigned char stat;
+
+    if (bridge_read(br, CROSSLINK_REG_UART_STAT, &stat, 1) < 0)
+        return 0;
+    return (stat & UART_STAT_BOARD_DETECT) != 0;
+}
+
+// Wait until the TX fifo has drained, so a full fifo's worth can be written.
+static int bridge_wait_tx_empty(struct i2c_bridge *br, long long deadline) {
+    unsigned char stat;
+
+    do {
+        if (bridge_read(br, CROSSLINK_REG_UART_STAT, &stat, 1) < 0)
+            return -1;
+        if (!(stat & UART_STAT_BUSY_TX) && (stat & UART_STAT_EMPTY_TX))
+            return 0;
+        usleep(BRIDGE_POLL_US);
+    } while (time_ms() < deadline);
+    fprintf(stderr, "timeout waiting for bridge tx fifo\n");
+    return -1;
+}
+
+// Same contract as send_data() + recv_data() on a tty: flush stale RX, send, then wait for a
+// response ending in 0xFF (or wait_for_bytes bytes) within timeout_ms.
+int i2c_bridge_xfer(struct i2c_bridge *br, const unsigned char *tx, int tx_len,
+                    int timeout_ms, int wait_for_bytes, unsigned char *buf, int buf_size) {
+    unsigned char junk[BRIDGE_FIFO_SIZE];
+    long long deadline = time_ms() + timeout_ms;
+    int len = 0;
+
+    // clear rx fifo
+    if (bridge_read_fifo(br, junk, sizeof(junk)) < 0)
+        return -1;
+
+    // tx, gated on fifo space
+    for (int done = 0; done < tx_len; ) {
+        int chunk = tx_len - done > BRIDGE_FIFO_SIZE ? BRIDGE_FIFO_SIZE : tx_len - done;
+        if (bridge_wait_tx_empty(br, deadline) < 0)
+            return -1;
+        if (bridge_write_fifo(br, tx + done, chunk) < 0)
+            return -1;
+        done += chunk;
+    }
+
+    // rx
+    while (len < buf_size) {
+        int n = bridge_read_fifo(br, buf + len, buf_size - len);
+        if (n < 0)
+            return -1;
+        len += n;
+        if (wait_for_bytes && len >= wait_for_bytes)
+            break;
+        else if (!wait_for_bytes && len > 0 && buf[len - 1] == 0xFF)
+            break;
+        if (time_ms() >= deadline) {
+            fprintf(stderr, "No data within timeout period.\n");
+            break;
+        }
+        if (n == 0)
+            usleep(BRIDGE_POLL_US);
+    }
+    return len;
+}
@@ -0,0 +1,297 @@
+// SPDX-License-Identifier: MIT
+// Multi-port mode: drives several serial ports at once from one epoll loop.
+// Each port has its own command queue, so e.g. cam0 and cam1 setup sequences overlap.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/epoll.h>
+
+#include "serial-xfer.h"
+
+#define DEFAULT_MULTI_BAUD 9600
+
+struct port_cmd {
+    unsigned char data[64];
+    int len;
+    int timeout_ms;
+    int wait_for_bytes;
+    struct port_cmd *next;
+};
+
+struct port {
+    char name[32];
+    char dev[128];
+    int baud;
+    int fd;
+    struct port_cmd *head, *tail;   // queued commands
+    struct port_cmd *cur;           // command waiting for a response
+    long long deadline;             // ms, CLOCK_MONOTONIC
+    unsigned char rx[256];
+    int rx_len;
+};
+
+static struct port ports[MAX_PORTS];
+static int nports;
+
+static long long time_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Add a port from a "name:device[:baud]" spec
+int multi_port_add(const char *spec) {
+    struct port *p;
+    const char *dev, *baud;
+
+    if (nports >= MAX_PORTS) {
+        fprintf(stderr, "too many ports, max %d\n", MAX_PORTS);
+        return -1;
+    }
+    dev = strchr(spec, ':');
+    if (!dev || dev == spec || (size_t)(dev - spec) >= sizeof(p->name)) {
+        fprintf(stderr, "invalid port spec: %s\n", spec);
+        return -1;
+    }
+    p = &ports[nports];
+    memset(p, 0, sizeof(*p));
+    memcpy(p->name, spec, dev - spec);
+    dev++;
+    baud = strchr(dev, ':');
+    snprintf(p->dev, sizeof(p->dev), "%.*s", baud ? (int)(baud - dev) : (int)strlen(dev), dev);
+    p->baud = baud ? atoi(baud + 1) : DEFAULT_MULTI_BAUD;
+    if (p->baud <= 0) {
+        fprintf(stderr, "invalid baudrate in port spec: %s\n", spec);
+        return -1;
+    }
+    p->fd = -1;
+    nports++;
+    return 0;
+}
+
+static struct port *find_port(const char *name) {
+    for (int i = 0; i < nports; i++)
+        if (strcmp(ports[i].name, name) == 0)
+            return &ports[i];
+    return NULL;
+}
+
+// Parse one script line: "<port> <hex-data> [timeout] [wait for n bytes]"
+static int queue_line(char *line, int lineno) {
+    char name[32], hex[130];
+    int timeout = DEFAULT_TIMEOUT, wait_for_bytes = 0;
+    struct port_cmd *cmd;
+    struct port *p;
+    char *c = line + strspn(line, " \t");
+
+    if (*c == '\0' || *c == '\n' || *c == '#')
+        return 0;
+    if (sscanf(c, "%31s %129s %d %d", name, hex, &timeout, &wait_for_bytes) < 2) {
+        fprintf(stderr, "line %d: expected '<port> <hex-data> [timeout] [wait for n bytes]'\n", lineno);
+        return -1;
+    }
+    p = find_port(name);
+    if (!p) {
+        fprintf(stderr, "line %d: unknown port '%s'\n", lineno, name);
+        return -1;
+    }
+    cmd = calloc(1, sizeof(*cmd));
+    if (!cmd)
+        return -1;
+    cmd->len = parse_hex(hex, cmd->data, sizeof(cmd->data));
+    if (cmd->len < 0) {
+        free(cmd);
+        return -1;
+    }
+    cmd->timeout_ms = timeout;
+    cmd->wait_for_bytes = wait_for_bytes;
+    if (p->tail)
+        p->tail->next = cmd;
+    else
+        p->head = cmd;
+    p->tail = cmd;
+    return 0;
+}
+
+// Write the result line "<port> <hex>" for the current command and free it
+static void finish_cmd(struct port *p, int out_fd) {
+    char line[sizeof(p->name) + 2];
+    int n = snprintf(line, sizeof(line), "%s ", p->name);
+
+    write_all(out_fd, (unsigned char *)line, n);
+    write_response(out_fd, p->rx, p->rx_len, 0);
+    write_all(out_fd, (unsigned char *)"\n", 1);
+    free(p->cur);
+    p->cur = NULL;
+}
+
+// Write the result line "<port> error" for a command that was never answered and free it, so
+// callers matching result lines to commands stay in step
+static void fail_cmd(struct port *p, struct port_cmd *cmd, int out_fd) {
+    char line[sizeof(p->name) + 8];
+    int n = snprintf(line, sizeof(line), "%s error\n", p->name);
+
+    write_all(out_fd, (unsigned char *)line, n);
+    free(cmd);
+}
+
+// Fail every command still queued on a port that cannot be used
+static void fail_queue(struct port *p, int out_fd) {
+    while (p->head) {
+        struct port_cmd *cmd = p->head;
+        p->head = cmd->next;
+        fail_cmd(p, cmd, out_fd);
+    }
+    p->tail = NULL;
+}
+
+// Send the next queued command on a port. Returns 1 if a command is in flight.
+static int start_next(struct port *p, int out_fd) {
+    while (p->head) {
+        p->cur = p->head;
+        p->head = p->cur->next;
+        if (!p->head)
+            p->tail = NULL;
+        p->rx_len = 0;
+        if (write_all(p->fd, p->cur->data, p->cur->len) == p->cur->len) {
+            p->deadline = time_ms() + p->cur->timeout_ms;
+            return 1;
+        }
+        fprintf(stderr, "%s: write failed\n", p->name);
+        fail_cmd(p, p->cur, out_fd);
+        p->cur = NULL;
+    }
+    return 0;
+}
+
+// Like start_next, but an idle port leaves the epoll set: nothing drains it any more, so stray input
+// would keep the level-triggered epoll_wait returning until the other ports are done
+static int port_next(struct port *p, int ep, int out_fd) {
+    if (start_next(p, out_fd))
+        return 1;
+    epoll_ctl(ep, EPOLL_CTL_DEL, p->fd, NULL);
+    return 0;
+}
+
+static int response_complete(struct port *p) {
+    if (p->cur->wait_for_bytes)
+        return p->rx_len >= p->cur->wait_for_bytes;
+    return p->rx_len > 0 && p->rx[p->rx_len - 1] == 0xFF;
+}
+
+// Read commands from in_fd, then run all port queues concurrently.
+// Writes one "<port> <hex-response>" line per command to out_fd, in completion order, or
+// "<port> error" for a command that could not be sent.
+int multi_port_run(struct serial_opts *opts, int in_fd, int out_fd) {
+    struct epoll_event ev, events[MAX_PORTS];
+    int ret = 0, active = 0, lineno = 0;
+    char *line = NULL;
+    size_t line_size = 0;
+    FILE *in;
+    int ep;
+
+    in = fdopen(in_fd, "r");
+    if (!in) {
+        perror("fdopen");
+        return 1;
+    }
+    while (getline(&line, &line_size, in) != -1)
+        if (queue_line(line, ++lineno) != 0)
+            ret = 1;
+    free(line);
+    if (ret)
+        return ret;
+
+    ep = epoll_create1(EPOLL_CLOEXEC);
+    if (ep < 0) {
+        perror("epoll_create1");
+        return 1;
+    }
+
+    for (int i = 0; i < nports; i++) {
+        struct port *p = &ports[i];
+        struct serial_opts popts = *opts;
+
+        p->fd = open(p->dev, O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (p->fd < 0) {
+            perror(p->dev);
+            fail_queue(p, out_fd);
+            ret = 1;
+            continue;
+        }
+        popts.baud = p->baud;
+        flush_rx_buffer(p->fd);
+        if (setup_serial(p->fd, &popts) != 0) {
+            close(p->fd);
+            p->fd = -1;
+            fail_queue(p, out_fd);
+            ret = 1;
+            continue;
+        }
+        ev.events = EPOLLIN;
+        ev.data.ptr = p;
+        if (epoll_ctl(ep, EPOLL_CTL_ADD, p->fd, &ev) != 0) {
+            perror("epoll_ctl");
+            fail_queue(p, out_fd);
+            ret = 1;
+            continue;
+        }
+        active += port_next(p, ep, out_fd);
+    }
+
+    while (active > 0) {
+        long long now = time_ms();
+        long long next = -1;
+        int n;
+
+        for (int i = 0; i < nports; i++)
+            if (ports[i].cur && (next < 0 || ports[i].deadline < next))
+                next = ports[i].deadline;
+
+        n = epoll_wait(ep, events, MAX_PORTS, next > now ? (int)(next - now) : 0);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait");
+            ret = 1;
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            struct port *p = events[i].data.ptr;
+            int r = read(p->fd, p->rx + p->rx_len, sizeof(p->rx) - p->rx_len);
+
+            if (r <= 0 || !p->cur)
+                continue;   // stray bytes between commands are dropped
+            p->rx_len += r;
+            if (response_complete(p) || p->rx_len == sizeof(p->rx)) {
+                finish_cmd(p, out_fd);
+                active--;
+                active += port_next(p, ep, out_fd);
+            }
+        }
+
+        now = time_ms();
+        for (int i = 0; i < nports; i++) {
+            struct port *p = &ports[i];
+            if (p->cur && now >= p->deadline) {
+                fprintf(stderr, "%s: No data within timeout period.\n", p->name);
+                if (p->rx_len == 0)
+                    ret = 1;
+                finish_cmd(p, out_fd);
+                active--;
+                active += port_next(p, ep, out_fd);
+            }
+        }
+    }
+
+    for (int i = 0; i < nports; i++)
+        if (ports[i].fd >= 0)
+            close(ports[i].fd);
+    close(ep);
+    return ret;
+}
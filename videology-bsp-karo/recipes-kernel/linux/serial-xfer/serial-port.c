@@ -0,0 +1,231 @@
+// SPDX-License-Identifier: MIT
+// tty helpers shared by serial-xfer and crosslink-moded.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <errno.h>
+#include <sys/select.h>
+#include <sys/ioctl.h>
+
+#include "serial-xfer.h"
+
+static int serial_baudrate_to_bits(int baudrate) {
+    switch (baudrate) {
+        case 1200: return B1200;
+        case 1800: return B1800;
+        case 2400: return B2400;
+        case 4800: return B4800;
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 500000: return B500000;
+        case 576000: return B576000;
+        case 921600: return B921600;
+        case 1000000: return B1000000;
+        default: return -1;
+    }
+}
+
+// Function to configure the serial port
+int setup_serial(int fd, struct serial_opts *opts) {
+    struct termios tty;
+    int speed = serial_baudrate_to_bits(opts->baud);
+
+    if (tcgetattr(fd, &tty) != 0) {
+        perror("tcgetattr");
+        return -1;
+    }
+
+    // non-standard rates are set with termios2 below, after the rest of the settings are applied.
+    if (speed != -1) {
+        cfsetospeed(&tty, speed);
+        cfsetispeed(&tty, speed);
+    }
+
+    tty.c_cflag &= ~PARENB; // No parity
+    tty.c_cflag &= ~CSTOPB; // 1 stop bit
+    tty.c_cflag &= ~CSIZE;
+    tty.c_cflag |= CS8; // 8 data bits
+    if (opts->rtscts)
+        tty.c_cflag |= CRTSCTS; // RTS/CTS hardware flow control
+    else
+        tty.c_cflag &= ~CRTSCTS; // No hardware flow control
+    tty.c_cflag |= CREAD | CLOCAL; // Enable receiver, ignore modem control lines
+
+    tty.c_lflag &= ~ICANON; // Non-canonical mode
+    tty.c_lflag &= ~ECHO; // Disable echo
+    tty.c_lflag &= ~ECHOE; // Disable erasure
+    tty.c_lflag &= ~ECHONL; // Disable new-line echo
+    tty.c_lflag &= ~ISIG; // Disable interpretation of INTR, QUIT and SUSP
+
+    tty.c_iflag &= ~(IXON | IXOFF | IXANY); // Turn off software flow control
+    tty.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL); // Disable special handling of received bytes
+
+    tty.c_oflag &= ~OPOST; // Prevent special interpretation of output bytes (e.g. newline chars)
+    tty.c_oflag &= ~ONLCR; // Prevent conversion of newline to carriage return/line feed
+
+    tty.c_cc[VTIME] = opts->vtime; // default 0: No blocking read
+    tty.c_cc[VMIN] = opts->vmin; // default 0: Read doesn't block
+
+    // Save tty settings, also checking for error
+    if (tcsetattr(fd, TCSANOW, &tty) != 0) {
+        perror("tcsetattr");
+        return -1;
+    }
+
+    if (speed == -1 && serial_set_custom_baud(fd, opts->baud) != 0)
+        return -1;
+
+    if (opts->low_latency)
+        serial_set_low_latency(fd, 1);
+
+    return 0;
+}
+
+// Function to convert a hex string to binary data. Appends 0xFF if not present.
+// Returns the number of bytes, or -1 on bad input.
+int parse_hex(const char *hex_string, unsigned char *data, int max_len) {
+    int len = 0;
+
+    if (strlen(hex_string) % 2) {
+        fprintf(stderr, "odd number of hex digits: %s\n", hex_string);
+        return -1;
+    }
+    for (const char *p = hex_string; *p; p += 2) {
+        if (!isxdigit((unsigned char)p[0]) || !isxdigit((unsigned char)p[1]) || len >= max_len) {
+            fprintf(stderr, "invalid hex data: %s\n", hex_string);
+            return -1;
+        }
+        sscanf(p, "%2hhx", &data[len++]);
+    }
+    if (len == 0 || data[len - 1] != 0xFF) {
+        if (len >= max_len)
+            return -1;
+        data[len++] = 0xFF;
+    }
+    return len;
+}
+
+// Function to read raw binary data from a fd (stdin by default), up to max_len bytes or EOF.
+int read_raw(int in_fd, unsigned char *data, int max_len) {
+    int len = 0;
+    while (len < max_len) {
+        int n = read(in_fd, data + len, max_len - len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("read");
+            return -1;
+        }
+        if (n == 0)
+            break;
+        len += n;
+    }
+    return len;
+}
+
+// Function to write a whole buffer, retrying on short writes
+int write_all(int fd, const unsigned char *data, int len) {
+    int done = 0;
+    while (done < len) {
+        int n = write(fd, data + done, len - done);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("write");
+            return -1;
+        }
+        done += n;
+    }
+    return done;
+}
+
+// Function to send data
+int send_data(int fd, const unsigned char *data, int len) {
+    // Write data to serial port
+    return write_all(fd, data, len);
+}
+
+// Function to write the response, either raw or as one hex string
+int write_response(int out_fd, const unsigned char *buf, int len, int binary) {
+    static const char digits[] = "0123456789ABCDEF";
+    char hex[2 * 1024];
+
+    if (binary)
+        return write_all(out_fd, buf, len);
+
+    if (len > (int)sizeof(hex) / 2)
+        len = sizeof(hex) / 2;
+    for (int i = 0; i < len; i++) {
+        hex[2*i]     = digits[buf[i] >> 4];
+        hex[2*i + 1] = digits[buf[i] & 0xF];
+    }
+    return write_all(out_fd, (unsigned char *)hex, 2 * len);
+}
+
+// Function to get the number of characters in the RX buffer
+int get_rx_buffer_count(int fd) {
+    int count = 0;
+    if (ioctl(fd, TIOCINQ, &count) == -1) {
+        perror("ioctl TIOCINQ");
+        return -1; // Return -1 in case of error
+    }
+    return count;
+}
+
+// Function to flush the RX buffer
+void flush_rx_buffer(int fd) {
+    if (tcflush(fd, TCIFLUSH) == -1) {
+        perror("tcflush");
+    }
+}
+
+// Function to receive data
+int recv_data(int fd, int timeout_ms, int wait_for_bytes, unsigned char *buf, int buf_size) {
+    fd_set read_fds;
+    struct timeval timeout;
+    int retval;
+    unsigned char *p = buf;
+    int n;
+
+    // Set up the timeout structure
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_usec = (timeout_ms % 1000) * 1000;
+
+    // Loop to read data
+    while (1) {
+        FD_ZERO(&read_fds);
+        FD_SET(fd, &read_fds);
+
+        // Wait for data to be available for reading
+        retval = select(fd + 1, &read_fds, NULL, NULL, &timeout);
+
+        if (retval == -1) {
+            perror("select()");
+            break;
+        } else if (retval) {
+            // Data is available to read
+            n = read(fd, p, buf_size - (p - buf));
+            if (n <= 0)
+                continue;
+            unsigned char end = p[n - 1];
+            p += n;
+            if (wait_for_bytes && (p - buf) >= wait_for_bytes)
+                break;
+            else if (end == 0xFF) // Check for end of packet (0xFF)
+                break;
+        } else {
+            fprintf(stderr, "No data within timeout period.\n");
+            break;
+        }
+    }
+    return p-buf;
+}
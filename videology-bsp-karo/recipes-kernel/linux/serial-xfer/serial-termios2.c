@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: MIT
+// termios2 helpers. Kept in their own file as <asm/termbits.h> clashes with glibc's <termios.h>.
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <asm/termbits.h>
+#include <linux/serial.h>
+
+#include "serial-xfer.h"
+
+// Set an arbitrary baudrate using BOTHER. Used for rates not in the Bxxxx table.
+int serial_set_custom_baud(int fd, int baudrate) {
+    struct termios2 tio;
+
+    if (ioctl(fd, TCGETS2, &tio) != 0) {
+        perror("ioctl TCGETS2");
+        return -1;
+    }
+
+    tio.c_cflag &= ~CBAUD;
+    tio.c_cflag |= BOTHER;
+    tio.c_cflag &= ~(CBAUD << IBSHIFT);
+    tio.c_cflag |= BOTHER << IBSHIFT;
+    tio.c_ospeed = baudrate;
+    tio.c_ispeed = baudrate;
+
+    if (ioctl(fd, TCSETS2, &tio) != 0) {
+        perror("ioctl TCSETS2");
+        return -1;
+    }
+    return 0;
+}
+
+// Set or clear ASYNC_LOW_LATENCY. Not all drivers support TIOCSSERIAL (e.g. pty), so failure is only a warning.
+int serial_set_low_latency(int fd, int enable) {
+    struct serial_struct ss;
+
+    if (ioctl(fd, TIOCGSERIAL, &ss) != 0) {
+        perror("ioctl TIOCGSERIAL");
+        return -1;
+    }
+    if (enable)
+        ss.flags |= ASYNC_LOW_LATENCY;
+    else
+        ss.flags &= ~ASYNC_LOW_LATENCY;
+    if (ioctl(fd, TIOCSSERIAL, &ss) != 0) {
+        perror("ioctl TIOCSSERIAL");
+        return -1;
+    }
+    return 0;
+}
@@ -1,207 +1,195 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <termios.h>
-#include <errno.h>
-#include <sys/select.h>
 #include <getopt.h>
-#include <sys/ioctl.h>
+#include <time.h>
 
+#include "serial-xfer.h"
 
-#define DEFAULT_TIMEOUT 200 // Default timeout in milliseconds
-
-static int serial_baudrate_to_bits(int baudrate) {
-    switch (baudrate) {
-        case 1200: return B1200;
-        case 1800: return B1800;
-        case 2400: return B2400;
-        case 4800: return B4800;
-        case 9600: return B9600;
-        case 19200: return B19200;
-        case 38400: return B38400;
-        case 57600: return B57600;
-        case 115200: return B115200;
-        case 230400: return B230400;
-        case 460800: return B460800;
-        case 500000: return B500000;
-        case 576000: return B576000;
-        case 921600: return B921600;
-        case 1000000: return B1000000;
-        default: return -1;
-    }
+static long long time_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 }
 
-// Function to configure the serial port
-int setup_serial(int fd, int speed) {
-    struct termios tty;
-
-    if (tcgetattr(fd, &tty) != 0) {
-        perror("tcgetattr");
-        return -1;
-    }
-
-    cfsetospeed(&tty, speed);
-    cfsetispeed(&tty, speed);
-
-    tty.c_cflag &= ~PARENB; // No parity
-    tty.c_cflag &= ~CSTOPB; // 1 stop bit
-    tty.c_cflag &= ~CSIZE;
-    tty.c_cflag |= CS8; // 8 data bits
-    tty.c_cflag &= ~CRTSCTS; // No hardware flow control
-    tty.c_cflag |= CREAD | CLOCAL; // Enable receiver, ignore modem control lines
-
-    tty.c_lflag &= ~ICANON; // Non-canonical mode
-    tty.c_lflag &= ~ECHO; // Disable echo
-    tty.c_lflag &= ~ECHOE; // Disable erasure
-    tty.c_lflag &= ~ECHONL; // Disable new-line echo
-    tty.c_lflag &= ~ISIG; // Disable interpretation of INTR, QUIT and SUSP
-
-    tty.c_iflag &= ~(IXON | IXOFF | IXANY); // Turn off software flow control
-    tty.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL); // Disable special handling of received bytes
-
-    tty.c_oflag &= ~OPOST; // Prevent special interpretation of output bytes (e.g. newline chars)
-    tty.c_oflag &= ~ONLCR; // Prevent conversion of newline to carriage return/line feed
-
-    tty.c_cc[VTIME] = 0; // No blocking read
-    tty.c_cc[VMIN] = 0; // Read doesn't block
-
-    // Save tty settings, also checking for error
-    if (tcsetattr(fd, TCSANOW, &tty) != 0) {
-        perror("tcsetattr");
-        return -1;
-    }
-
-    return 0;
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options] baud device hex-data [timeout] [wait for n bytes] [outfile]\n", prog);
+    fprintf(stderr, "       %s [options] --i2c-bridge i2c-device[@addr] hex-data [timeout] [wait for n bytes] [outfile]\n", prog);
+    fprintf(stderr, "writes hex-data to serial dev, waits for a response and writes hex to stdio [or outfile].\n" );
+    fprintf(stderr, "Designed for strings ending in 0xFF. Any baudrate is accepted; non-standard rates use termios2.\n" );
+    fprintf(stderr, "If hex-data is '-', raw bytes are read from stdin (or --in-fd) and sent as-is.\n" );
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -r, --rtscts        enable RTS/CTS hardware flow control\n");
+    fprintf(stderr, "  -l, --low-latency   set ASYNC_LOW_LATENCY on the port\n");
+    fprintf(stderr, "  -m, --vmin N        termios VMIN (default 0)\n");
+    fprintf(stderr, "  -t, --vtime N       termios VTIME in 1/10 s (default 0)\n");
+    fprintf(stderr, "  -n, --repeat N      repeat the transfer N times and report round-trip latency on stderr\n");
+    fprintf(stderr, "  -b, --binary        write the response as raw bytes instead of hex\n");
+    fprintf(stderr, "  -i, --in-fd N       read raw tx data from fd N instead of stdin\n");
+    fprintf(stderr, "  -o, --out-fd N      write the response to fd N instead of stdout\n");
+    fprintf(stderr, "  -I, --i2c-bridge i2c-device[@addr]\n");
+    fprintf(stderr, "                      use the crosslink I2C-to-UART bridge instead of a tty (default addr 0x1c)\n");
+    fprintf(stderr, "  -p, --port name:device[:baud]\n");
+    fprintf(stderr, "                      multi-port mode, may be repeated. Commands are read from stdin (or --in-fd),\n");
+    fprintf(stderr, "                      one '<name> <hex-data> [timeout] [wait for n bytes]' per line. Ports run\n");
+    fprintf(stderr, "                      concurrently, each in order, and '<name> <hex-response>' lines are written out.\n");
+    fprintf(stderr, "                      Commands that cannot be sent get a '<name> error' line.\n");
+    fprintf(stderr, "Example: %s 9600 /dev/ttyUSB0 100\n", prog);
+    fprintf(stderr, "Example: %s --i2c-bridge /dev/links/csi1_i2c@0x1c 81090002FF 50\n", prog);
+    fprintf(stderr, "Example: printf 'cam0 81090002FF\\ncam1 81090002FF\\n' | %s -p cam0:/dev/ttymxc3 -p cam1:/dev/ttymxc1\n", prog);
 }
 
-// Function to send data
-int send_data(int fd, char *hex_string) {
-    // convert to uppercase
-    for (char *p = hex_string; *p; ++p) *p = toupper(*p);
-    // Append 0xFF if not present
-    if (hex_string[strlen(hex_string) - 2] != 'F' || hex_string[strlen(hex_string) - 1] != 'F') {
-        strcat(hex_string, "FF");
-    }
-
-    int len = strlen(hex_string) / 2;
-    unsigned char *data = (unsigned char *)malloc(len);
-
-    // Convert hex string to binary data
-    for (int i = 0; i < len; ++i) {
-        sscanf(hex_string + 2*i, "%2hhx", &data[i]);
+int main(int argc, char *argv[]) {
+    unsigned char buf[1024];
+    unsigned char tx[1024];
+    struct serial_opts opts = { 0 };
+    int repeat = 1;
+    int binary = 0;
+    int in_fd = STDIN_FILENO;
+    int out_fd = STDOUT_FILENO;
+    int multi = 0;
+    const char *bridge_spec = NULL;
+    const char *prog = argv[0];
+    int opt;
+
+    static const struct option long_opts[] = {
+        { "rtscts",      no_argument,       NULL, 'r' },
+        { "low-latency", no_argument,       NULL, 'l' },
+        { "vmin",        required_argument, NULL, 'm' },
+        { "vtime",       required_argument, NULL, 't' },
+        { "repeat",      required_argument, NULL, 'n' },
+        { "binary",      no_argument,       NULL, 'b' },
+        { "in-fd",       required_argument, NULL, 'i' },
+        { "out-fd",      required_argument, NULL, 'o' },
+        { "port",        required_argument, NULL, 'p' },
+        { "i2c-bridge",  required_argument, NULL, 'I' },
+        { "help",        no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    while ((opt = getopt_long(argc, argv, "rlm:t:n:bi:o:p:I:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+            case 'r': opts.rtscts = 1; break;
+            case 'l': opts.low_latency = 1; break;
+            case 'm': opts.vmin = atoi(optarg); break;
+            case 't': opts.vtime = atoi(optarg); break;
+            case 'n': repeat = atoi(optarg); break;
+            case 'b': binary = 1; break;
+            case 'i': in_fd = atoi(optarg); break;
+            case 'o': out_fd = atoi(optarg); break;
+            case 'I': bridge_spec = optarg; break;
+            case 'p':
+                if (multi_port_add(optarg) != 0)
+                    return 1;
+                multi = 1;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
     }
+    argc -= optind - 1;
+    argv += optind - 1;
 
-    // Write data to serial port
-    int ret = write(fd, data, len);
-    free(data);
-    return ret;
-}
-
-// Function to get the number of characters in the RX buffer
-int get_rx_buffer_count(int fd) {
-    int count = 0;
-    if (ioctl(fd, TIOCINQ, &count) == -1) {
-        perror("ioctl TIOCINQ");
-        return -1; // Return -1 in case of error
+    if (multi) {
+        if (argc > 1 || opts.vmin < 0 || opts.vmin > 255 || opts.vtime < 0 || opts.vtime > 255) {
+            usage(prog);
+            return 1;
+        }
+        return multi_port_run(&opts, in_fd, out_fd);
     }
-    return count;
-}
 
-// Function to flush the RX buffer
-void flush_rx_buffer(int fd) {
-    if (tcflush(fd, TCIFLUSH) == -1) {
-        perror("tcflush");
+    // the bridge has no baud or device positional arguments, hex-data comes first.
+    int a = bridge_spec ? 1 : 3;
+    if (argc < a + 1 || opts.vmin < 0 || opts.vmin > 255 || opts.vtime < 0 || opts.vtime > 255 || repeat < 1) {
+        usage(prog);
+        return 1;
     }
-}
 
-// Function to receive data
-int recv_data(int fd, int timeout_ms, int wait_for_bytes, unsigned char *buf, int buf_size) {
-    fd_set read_fds;
-    struct timeval timeout;
-    int retval;
-    unsigned char *p = buf;
-    int n;
-
-    // Set up the timeout structure
-    timeout.tv_sec = timeout_ms / 1000;
-    timeout.tv_usec = (timeout_ms % 1000) * 1000;
-
-    // Loop to read data
-    while (1) {
-        FD_ZERO(&read_fds);
-        FD_SET(fd, &read_fds);
-
-        // Wait for data to be available for reading
-        retval = select(fd + 1, &read_fds, NULL, NULL, &timeout);
-
-        if (retval == -1) {
-            perror("select()");
-            break;
-        } else if (retval) {
-            // Data is available to read
-            n = read(fd, p, buf_size - (p - buf));
-            unsigned char end = p[n - 1];
-            p += n;
-            if (wait_for_bytes && (p - buf) >= wait_for_bytes)
-                break;
-            else if (end == 0xFF) // Check for end of packet (0xFF)
-                break;
-        } else {
-            fprintf(stderr, "No data within timeout period.\n");
-            break;
+    if (!bridge_spec) {
+        // get baud from 1st argument
+        opts.baud = atoi(argv[1]);
+        if (opts.baud <= 0) {
+            fprintf(stderr, "invalid baudrate: %s\n", argv[1]);
+            return 1;
         }
     }
-    return p-buf;
-}
 
-int main(int argc, char *argv[]) {
-    unsigned char buf[1024];
-    if (argc < 4) {
-        fprintf(stderr, "Usage: %s baud device hex-data [timeout] [wait for n bytes] [outfile]\n", argv[0]);
-        fprintf(stderr, "writes hex-data to serial dev, waits for a response and writes hex to stdio [or outfile].\n" );
-        fprintf(stderr, "Designed for strings ending in 0xFF.\n" );
-        fprintf(stderr, "Example: %s 9600 /dev/ttyUSB0 100\n", argv[0]);
+    int tx_len;
+    if (strcmp(argv[a], "-") == 0)
+        tx_len = read_raw(in_fd, tx, sizeof(tx));
+    else
+        tx_len = parse_hex(argv[a], tx, sizeof(tx));
+    if (tx_len == 0)
+        fprintf(stderr, "no data to send\n");
+    if (tx_len <= 0)
         return 1;
-    }
 
-    int fd = open(argv[2], O_RDWR | O_NOCTTY | O_SYNC);
-    if (fd < 0) {
-        perror(argv[2]);
-        return 1;
-    }
-    flush_rx_buffer(fd);
-    // get baud from 2nd argument
-    int baud = atoi(argv[1]);
-    if (setup_serial(fd, serial_baudrate_to_bits(baud)) != 0) {
-        close(fd);
-        return 1;
+    struct i2c_bridge bridge = { .fd = -1 };
+    int fd = -1;
+    if (bridge_spec) {
+        if (i2c_bridge_open(bridge_spec, &bridge) != 0)
+            return 1;
+    } else {
+        fd = open(argv[2], O_RDWR | O_NOCTTY | O_SYNC);
+        if (fd < 0) {
+            perror(argv[2]);
+            return 1;
+        }
+        flush_rx_buffer(fd);
+        if (setup_serial(fd, &opts) != 0) {
+            close(fd);
+            return 1;
+        }
     }
 
     int ret = 1;
-    int timeout = (argc >= 5) ? atoi(argv[4]) : DEFAULT_TIMEOUT;
-    int wait_for_bytes = (argc >= 6) ? atoi(argv[5]) : 0;
-    char *oufile = (argc >= 7) ? argv[6] : NULL;
-    if ( send_data(fd, argv[3]) > 0 ) {
-        tcdrain(fd);                // Wait until all data is sent
-        int r=recv_data(fd, timeout, wait_for_bytes, buf, sizeof(buf));
-        if ((r) > 0)  // Now receive the response
-            if (oufile) {
-                FILE *fp = fopen(oufile, "w");
-                if (fp) {
-                    for (int i = 0; i < r; i++)
-                        fprintf(fp, "%02X", buf[i]);
-                    fclose(fp);
-                }
+    int timeout = (argc >= a + 2) ? atoi(argv[a + 1]) : DEFAULT_TIMEOUT;
+    int wait_for_bytes = (argc >= a + 3) ? atoi(argv[a + 2]) : 0;
+    char *oufile = (argc >= a + 4) ? argv[a + 3] : NULL;
+    long long t_min = -1, t_max = 0, t_sum = 0;
+    int r = 0;
+    for (int i = 0; i < repeat; i++) {
+        long long start = time_us();
+        if (bridge_spec) {
+            r = i2c_bridge_xfer(&bridge, tx, tx_len, timeout, wait_for_bytes, buf, sizeof(buf));
+            if (r < 0)
+                break;
+        } else {
+            if (send_data(fd, tx, tx_len) <= 0)
+                break;
+            tcdrain(fd);                // Wait until all data is sent
+            r = recv_data(fd, timeout, wait_for_bytes, buf, sizeof(buf));
+        }
+        long long t = time_us() - start;
+        t_sum += t;
+        if (t_min < 0 || t < t_min) t_min = t;
+        if (t > t_max) t_max = t;
+        ret = 0;
+    }
+    if (repeat > 1 && ret == 0)
+        fprintf(stderr, "baud %d rtscts %d low-latency %d vmin %d vtime %d: %d xfers, rtt min %lld us avg %lld us max %lld us\n",
+                opts.baud, opts.rtscts, opts.low_latency, opts.vmin, opts.vtime, repeat, t_min, t_sum / repeat, t_max);
+
+    if (ret == 0 && r > 0) {  // Now write out the response
+        if (oufile) {
+            int ofd = open(oufile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (ofd >= 0) {
+                write_response(ofd, buf, r, binary);
+                close(ofd);
             } else {
-                for (int i = 0; i < r; i++)
-                    printf("%02X", buf[i]);
+                perror(oufile);
             }
-            ret = 0;
+        } else {
+            write_response(out_fd, buf, r, binary);
+        }
     }
-    close(fd);
+    if (bridge_spec)
+        i2c_bridge_close(&bridge);
+    else
+        close(fd);
     return ret;
 }
-
@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: MIT
+#ifndef SERIAL_XFER_H
+#define SERIAL_XFER_H
+
+#define DEFAULT_TIMEOUT 200 // Default timeout in milliseconds
+
+// port settings, filled from the command line.
+struct serial_opts {
+    int baud;
+    int rtscts;         // enable RTS/CTS hardware flow control
+    int low_latency;    // set ASYNC_LOW_LATENCY on the port
+    int vmin;           // termios VMIN
+    int vtime;          // termios VTIME, in 1/10 s
+};
+
+// serial-port.c
+int setup_serial(int fd, struct serial_opts *opts);
+int parse_hex(const char *hex_string, unsigned char *data, int max_len);
+int read_raw(int in_fd, unsigned char *data, int max_len);
+int write_all(int fd, const unsigned char *data, int len);
+int send_data(int fd, const unsigned char *data, int len);
+int write_response(int out_fd, const unsigned char *buf, int len, int binary);
+int get_rx_buffer_count(int fd);
+void flush_rx_buffer(int fd);
+int recv_data(int fd, int timeout_ms, int wait_for_bytes, unsigned char *buf, int buf_size);
+
+// serial-multi.c
+#define MAX_PORTS 8
+int multi_port_add(const char *spec);
+int multi_port_run(struct serial_opts *opts, int in_fd, int out_fd);
+
+// serial-i2c.c
+struct i2c_bridge {
+    int fd;
+    int addr;
+};
+int i2c_bridge_open(const char *spec, struct i2c_bridge *br);
+void i2c_bridge_close(struct i2c_bridge *br);
+int i2c_bridge_present(struct i2c_bridge *br);
+int i2c_bridge_xfer(struct i2c_bridge *br, const unsigned char *tx, int tx_len,
+                    int timeout_ms, int wait_for_bytes, unsigned char *buf, int buf_size);
+
+// serial-termios2.c
+int serial_set_custom_baud(int fd, int baudrate);
+int serial_set_low_latency(int fd, int enable);
+
+#endif // SERIAL_XFER_H
@@ -0,0 +1,12 @@
+#!/bin/sh
+# Copyright (C) 2026/10/18 VideologyInc
+# Licensed on MIT
+
+# Runs crosslink-moded --replay on the recorded camera replies and compares the commands it sends
+# and its log with the expected output. Modes: 1080p30, the same again (nothing sent), 1080p25 (only
+# the changed frame rate and the reset), 1080p60, and one the config does not know.
+#
+# Usage: crosslink-moded-replay.sh path/to/crosslink-moded
+
+dir=$(dirname "$0")/crosslink-moded-replay
+"$1" -c "$dir/../../crosslink-moded.conf" -r "$dir/replies" < "$dir/modes" 2>&1 | diff -u "$dir/expected" -
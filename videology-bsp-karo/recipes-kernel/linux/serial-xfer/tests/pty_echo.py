@@ -0,0 +1,45 @@
+# SPDX-License-Identifier: MIT
+# Echo peer for the serial-xfer tests: a pty pair whose master side writes back everything sent to
+# the slave, optionally after a delay and with noise in front of the first reply, like a camera
+# that sends more than the command's answer. With line_rate the reply is held for the time its
+# bytes take on a wire at the baudrate set on the slave (8N1), which a pty does not do by itself.
+# The slave stays open here too, so the master never sees EIO.
+import fcntl
+import os
+import struct
+import threading
+import time
+import tty
+
+TCGETS2 = 0x802C542A
+TERMIOS2 = 'IIIIB19sII'     # iflag oflag cflag lflag line cc[19] ispeed ospeed
+
+
+class EchoPty:
+    def __init__(self, delay_ms=0, noise=0, line_rate=False):
+        self.master, self.slave = os.openpty()
+        tty.setraw(self.slave)
+        self.path = os.ttyname(self.slave)
+        self.delay = delay_ms / 1000
+        self.noise = noise
+        self.line_rate = line_rate
+        threading.Thread(target=self.run, daemon=True).start()
+
+    def baud(self):
+        buf = fcntl.ioctl(self.slave, TCGETS2, bytes(struct.calcsize(TERMIOS2)))
+        return struct.unpack(TERMIOS2, buf)[-1]
+
+    def run(self):
+        while True:
+            try:
+                data = os.read(self.master, 4096)
+            except OSError:
+                return
+            reply = b'\0' * self.noise + data
+            wait = self.delay
+            if self.line_rate:
+                wait += len(reply) * 10 / self.baud()
+            if wait:
+                time.sleep(wait)
+            os.write(self.master, reply)
+            self.noise = 0
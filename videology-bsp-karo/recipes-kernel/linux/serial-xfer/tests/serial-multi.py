@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+# Multi-port mode of serial-xfer on pty echo peers: cam0 answers at once with more than a port
+# buffer holds, so its command completes on a full buffer with bytes left over, cam1 answers after
+# a second, cam2 does not exist. Checks the result lines, and that the leftover bytes of the
+# finished cam0 do not keep the epoll loop busy while cam1 is waiting.
+#
+# Usage: serial-multi.py path/to/serial-xfer
+import os
+import resource
+import subprocess
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from pty_echo import EchoPty
+
+
+def main():
+    cam0 = EchoPty(noise=300)
+    cam1 = EchoPty(delay_ms=1000)
+    start = time.monotonic()
+    out = subprocess.run([sys.argv[1], '-p', 'cam0:' + cam0.path, '-p', 'cam1:' + cam1.path,
+                          '-p', 'cam2:/dev/nonexistent-tty'],
+                         input=b'cam0 81090002FF 2000\ncam1 81090002FF 2000\ncam2 81090002FF 2000\n',
+                         stdout=subprocess.PIPE, stderr=subprocess.DEVNULL).stdout.decode().split('\n')
+    wall = time.monotonic() - start
+    usage = resource.getrusage(resource.RUSAGE_CHILDREN)
+    cpu = usage.ru_utime + usage.ru_stime
+
+    errors = []
+    for line in ('cam0 ' + '00' * 256, 'cam1 81090002ff', 'cam2 error'):
+        if line not in (l.lower() for l in out):
+            errors.append('no "%s" line in %s' % (line, out))
+    if cpu > 0.3 * wall:
+        errors.append('%.2f s of CPU in %.2f s, the idle port keeps epoll_wait busy' % (cpu, wall))
+
+    for e in errors:
+        print('FAIL:', e)
+    if not errors:
+        print('ok: 3 ports, %.2f s of CPU in %.2f s' % (cpu, wall))
+    return 1 if errors else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,48 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+# Round-trip latency of serial-xfer against a pty echo peer that holds each reply for its wire time
+# at the configured baudrate. Sweeps the baudrate (3000000 goes through termios2), -r, -l and the
+# VMIN/VTIME pairs, and prints min/avg/max per setting. A pty has no RTS/CTS lines or
+# ASYNC_LOW_LATENCY, so -r and -l only show their cost in the tool here, their effect on a UART
+# needs the board. Fails when a transfer does not come back.
+#
+# Usage: serial-rtt.py path/to/serial-xfer [repeats]
+import os
+import re
+import subprocess
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from pty_echo import EchoPty
+
+BAUDS = (9600, 115200, 921600, 3000000)
+VMIN_VTIME = ((0, 0), (1, 0), (5, 0), (0, 1))
+CMD = '81090002FF'
+
+
+def main():
+    xfer = sys.argv[1]
+    repeats = sys.argv[2] if len(sys.argv) > 2 else '20'
+    peer = EchoPty(line_rate=True)
+    failed = 0
+
+    print('%8s %6s %3s %4s %5s %10s %10s %10s' % ('baud', 'rtscts', 'low', 'vmin', 'vtime', 'min us', 'avg us', 'max us'))
+    for baud in BAUDS:
+        for rtscts in (0, 1):
+            for low in (0, 1):
+                for vmin, vtime in VMIN_VTIME:
+                    args = [xfer, '-n', repeats, '-m', str(vmin), '-t', str(vtime)]
+                    args += ['-r'] if rtscts else []
+                    args += ['-l'] if low else []
+                    p = subprocess.run(args + [str(baud), peer.path, CMD, '500'], capture_output=True, text=True)
+                    rtt = re.search(r'rtt min (\d+) us avg (\d+) us max (\d+) us', p.stderr)
+                    if p.returncode or p.stdout != CMD or not rtt:
+                        print('FAIL: %s: %s %s' % (' '.join(args[1:]), p.stdout, p.stderr.strip()))
+                        failed = 1
+                        continue
+                    print('%8d %6d %3d %4d %5d %10s %10s %10s' % ((baud, rtscts, low, vmin, vtime) + rtt.groups()))
+    return failed
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -10,6 +10,10 @@ else
 fi
 
 setenv bootargs ${bootargs} root=/storage/bsp/${bootslot}/rootfs.squashfs ${append_bootargs} bootslot=${bootslot}
+# 'setenv boottrace 1' adds initcall and driver probe times to the kernel log for boot-profile
+if test -n "${boottrace}"; then
+	setenv bootargs ${bootargs} initcall_debug printk.time=1
+fi
 
 if test -e ${devtype} ${devnum}:${distro_bootpart} ${prefix}boot.env; then
 	load ${devtype} ${devnum}:${distro_bootpart} ${load_addr} ${prefix}boot.env && env import ${load_addr} ${filesize}
@@ -19,17 +23,27 @@ setenv initrd_addr -
 load ${devtype} ${devnum}:${distro_bootpart} ${ramdisk_addr_r} ${prefix}initrd && setenv initrd_addr ${ramdisk_addr_r}:${filesize}
 load ${devtype} ${devnum}:${distro_bootpart} ${kernel_addr_r} ${prefix}Image || load ${devtype} ${devnum}:${distro_bootpart} ${kernel_addr_r} ${prefix}Image-initramfs
 
-load ${devtype} ${devnum}:${distro_bootpart} ${fdt_addr_r} ${prefix}devicetree/default.dtb
-fdt addr ${fdt_addr_r}
-
+# karo-devicetrees pre-merges common overlay sets as <base>+<overlay>+...dtb, use one if it exists
+setenv fdt_variant ${fdt_base}
 for overlay_file in ${overlays}; do
-	if load ${devtype} ${devnum}:${distro_bootpart} ${load_addr} ${prefix}devicetree/${overlay_prefix}${overlay_file}.dtbo; then
-		echo "Applying kernel provided DT overlay ${overlay_prefix}${overlay_file}.dtbo"
-		fdt apply ${load_addr} || setenv overlay_error "true"
-	fi
+	setenv fdt_variant ${fdt_variant}+${overlay_prefix}${overlay_file}
 done
-if test "${overlay_error}" = "true"; then
-	echo "Error applying DT overlays, restoring original DT"
+if test -n "${fdt_base}" && test "${fdt_variant}" != "${fdt_base}" && load ${devtype} ${devnum}:${distro_bootpart} ${fdt_addr_r} ${prefix}devicetree/${fdt_variant}.dtb; then
+	echo "Using pre-merged DT ${fdt_variant}.dtb"
+	fdt addr ${fdt_addr_r}
+else
 	load ${devtype} ${devnum}:${distro_bootpart} ${fdt_addr_r} ${prefix}devicetree/default.dtb
+	fdt addr ${fdt_addr_r}
+
+	for overlay_file in ${overlays}; do
+		if load ${devtype} ${devnum}:${distro_bootpart} ${load_addr} ${prefix}devicetree/${overlay_prefix}${overlay_file}.dtbo; then
+			echo "Applying kernel provided DT overlay ${overlay_prefix}${overlay_file}.dtbo"
+			fdt apply ${load_addr} || setenv overlay_error "true"
+		fi
+	done
+	if test "${overlay_error}" = "true"; then
+		echo "Error applying DT overlays, restoring original DT"
+		load ${devtype} ${devnum}:${distro_bootpart} ${fdt_addr_r} ${prefix}devicetree/default.dtb
+	fi
 fi
 booti ${kernel_addr_r} ${initrd_addr} ${fdt_addr_r}
\ No newline at end of file
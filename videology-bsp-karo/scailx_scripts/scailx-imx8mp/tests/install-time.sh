@@ -0,0 +1,98 @@
+#!/bin/bash
+# Copyright (C) 2026/10/18 VideologyInc
+# Licensed on MIT
+
+# Install time of the stable collection's files on two loop-mounted ext4 images standing in for the
+# boot and storage partitions: the old sequence, which mounted, wrote and unmounted the partition
+# for every artifact, against the one in sw-description and update.sh now, which writes everything
+# into both mounted partitions and syncs once. Prints both times, and fails when an artifact does
+# not arrive intact. The loop devices sit on files of the host, so the numbers compare the two
+# sequences, not the eMMC. Needs root and loop devices, exits 77 (skipped) without them.
+#
+# Usage: install-time.sh [rootfs size MiB, default 128]
+
+[ "$(id -u)" = 0 ] || { echo "needs root, skipped"; exit 77; }
+
+tmp=$(mktemp -d)
+loops=""
+cleanup() {
+    umount $tmp/boot $tmp/storage 2> /dev/null
+    for l in $loops; do losetup -d $l; done
+    rm -rf $tmp
+}
+trap cleanup EXIT
+
+# the artifacts of one slot, sizes as in a release
+mkdir -p $tmp/swu/dtb $tmp/boot $tmp/storage
+head -c ${1:-128}M /dev/urandom > $tmp/swu/rootfs.squashfs
+head -c 30M /dev/urandom > $tmp/swu/Image-initramfs
+head -c 12M /dev/urandom > $tmp/swu/initramfs-extras.squashfs
+head -c 4K /dev/urandom > $tmp/swu/boot.scr
+for i in $(seq 40); do head -c 64K /dev/urandom > $tmp/swu/dtb/overlay-$i.dtbo; done
+tar -C $tmp/swu/dtb -czf $tmp/swu/devicetrees.tgz .
+
+# <name> <partition> <path in the partition>, in sw-description order
+ARTIFACTS="rootfs.squashfs storage bsp/1/rootfs.squashfs
+Image-initramfs boot bsp1/Image-initramfs
+initramfs-extras.squashfs boot bsp1/initramfs-extras.squashfs
+boot.scr boot bsp1/boot.scr
+devicetrees.tgz boot bsp1"
+
+for part in boot:256 storage:512; do
+    truncate -s ${part#*:}M $tmp/${part%:*}.img
+    mkfs.ext4 -q -F -L ${part%:*} $tmp/${part%:*}.img || exit 77
+    dev=$(losetup -f --show $tmp/${part%:*}.img) || { echo "no loop devices, skipped"; exit 77; }
+    loops="$loops $dev"
+    eval ${part%:*}_dev=$dev
+done
+
+# install <name> <partition> <path>: write one artifact the way swupdate does, a tgz is extracted
+install() {
+    if [ "${1%.tgz}" != "$1" ]; then
+        mkdir -p $tmp/$2/$3 && tar -C $tmp/$2/$3 -xzf $tmp/swu/$1
+    else
+        mkdir -p $(dirname $tmp/$2/$3) && cat $tmp/swu/$1 > $tmp/$2/$3
+    fi
+}
+
+now_ms() {
+    echo $(( $(date +%s%N) / 1000000 ))
+}
+
+fail=0
+verify() {
+    mount $boot_dev $tmp/boot && mount $storage_dev $tmp/storage
+    while read -r name part path; do
+        if [ "${name%.tgz}" != "$name" ]; then
+            (for f in $tmp/swu/dtb/*; do cmp -s $f $tmp/$part/$path/${f##*/} || exit 1; done)
+        else
+            cmp -s $tmp/swu/$name $tmp/$part/$path
+        fi || { echo "FAIL: $1: $name not installed"; fail=1; }
+    done <<< "$ARTIFACTS"
+    rm -rf $tmp/boot/bsp1 $tmp/storage/bsp
+    umount $tmp/boot $tmp/storage
+}
+
+sync; echo 3 > /proc/sys/vm/drop_caches 2> /dev/null
+start=$(now_ms)
+while read -r name part path; do
+    dev=${part}_dev
+    mount ${!dev} $tmp/$part && install $name $part $path && umount $tmp/$part
+done <<< "$ARTIFACTS"
+old=$(( $(now_ms) - start ))
+verify "mount per artifact"
+
+sync; echo 3 > /proc/sys/vm/drop_caches 2> /dev/null
+start=$(now_ms)
+mount $boot_dev $tmp/boot && mount $storage_dev $tmp/storage
+while read -r name part path; do
+    install $name $part $path
+done <<< "$ARTIFACTS"
+sync
+umount $tmp/boot $tmp/storage
+new=$(( $(now_ms) - start ))
+verify "both mounted"
+
+echo "mount per artifact: $old ms"
+echo "both mounted, one sync: $new ms"
+exit $fail
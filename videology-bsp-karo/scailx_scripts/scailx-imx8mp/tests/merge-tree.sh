@@ -0,0 +1,75 @@
+#!/bin/bash
+# Copyright (C) 2026/10/18 VideologyInc
+# Licensed on MIT
+
+# Host check of merge_tree from update.sh against the cp -fr it replaced: merges the overlay upper
+# etc of merge-tree/ into its persist etc, and into an empty persist, both ways, and compares the
+# results with diff -r. Git cannot hold them, so a whiteout (char device 0:0 over persist's motd)
+# and two opaque dirs (trusted.overlay.opaque, docker/ also in persist and containers/ new) are
+# added here. cp -fr drops xattrs, so for those the test checks that merge_tree still has the
+# whiteout and the opaque mark of the dir it moved whole. An opaque dir that persist already has is
+# merged like cp -fr did. Also checks that the copy in the storage initramfs module, which does the
+# merge on the next boot for updates installed from the booted system, is the same function.
+# Needs root for mknod and trusted xattrs, exits 77 (skipped) without it.
+#
+# Usage: merge-tree.sh
+
+[ "$(id -u)" = 0 ] || { echo "needs root, skipped"; exit 77; }
+
+here=$(dirname "$(readlink -f "$0")")
+tmp=$(mktemp -d)
+trap 'rm -rf $tmp' EXIT
+eval "$(sed -n '/^merge_tree() {/,/^}/p' $here/../update.sh)"
+
+opaque() {
+    python3 -c "import os, sys; os.setxattr(sys.argv[1], 'trusted.overlay.opaque', b'y')" "$1"
+}
+is_opaque() {
+    python3 -c "import os, sys; sys.exit(os.getxattr(sys.argv[1], 'trusted.overlay.opaque') != b'y')" "$1" 2> /dev/null
+}
+
+# tree <dir> <persist|empty>: the sample upper and persist, with the special entries added
+tree() {
+    mkdir -p $1
+    cp -a $here/merge-tree/upper $1/
+    if [ $2 = persist ]; then
+        cp -a $here/merge-tree/persist $1/
+    else
+        mkdir $1/persist
+    fi
+    mknod $1/upper/etc/motd c 0 0
+    opaque $1/upper/etc/docker && opaque $1/upper/etc/containers
+}
+
+fail=0
+check() {
+    if eval "$2"; then
+        echo "ok: $1"
+    else
+        echo "FAIL: $1"
+        fail=1
+    fi
+}
+
+for persist in persist empty; do
+    tree $tmp/$persist/merge $persist || { echo "cannot make the sample tree, skipped"; exit 77; }
+    tree $tmp/$persist/cp $persist
+    merge_tree $tmp/$persist/merge/upper/etc $tmp/$persist/merge/persist/etc
+    cp -fr -t $tmp/$persist/cp/persist $tmp/$persist/cp/upper/etc
+
+    p=$tmp/$persist/merge/persist/etc
+    # diff also compares the timestamps of device files, the whiteout is compared with stat
+    check "$persist: same tree as cp -fr" "diff -r --no-dereference -x motd $tmp/$persist/cp/persist $tmp/$persist/merge/persist"
+    check "$persist: upper etc moved out" "[ ! -e $tmp/$persist/merge/upper/etc ]"
+    check "$persist: whiteout kept" "[ \"\$(stat -c '%F %t:%T' $p/motd $tmp/$persist/cp/persist/etc/motd | uniq)\" = 'character special file 0:0' ]"
+    check "$persist: symlink kept" "[ \"\$(readlink $p/localtime)\" = ../usr/share/zoneinfo/Europe/Amsterdam ]"
+    check "$persist: new opaque dir kept its mark" "is_opaque $p/containers"
+done
+check "persist: opaque dir merged into persist's" "[ -f $tmp/persist/merge/persist/etc/docker/daemon.json ] && [ -f $tmp/persist/merge/persist/etc/docker/key.json ]"
+check "empty: opaque dir moved whole" "is_opaque $tmp/empty/merge/persist/etc/docker"
+
+storage=$here/../../../../videology-distro/recipes-core/initrdscripts/initramfs-framework/storage
+check "storage module has the same merge_tree" \
+    "sed -n '/^merge_tree() {/,/^}/p' $storage | diff -q - <(sed -n '/^merge_tree() {/,/^}/p' $here/../update.sh) > /dev/null"
+
+exit $fail
@@ -0,0 +1,80 @@
+#!/bin/bash
+# Copyright (C) 2026/10/18 VideologyInc
+# Licensed on MIT
+
+# Host check of the rootfs delta: makes a delta with the options squashfs_delta in
+# scailx-swupdate-image.bbclass uses, then runs apply_rootfs_delta from update.sh on a fake storage
+# partition and compares the rebuilt image with the original. Also checks that a wrong checksum or
+# a missing reference fails without touching the slot. Needs zstd, exits 77 (skipped) without it.
+#
+# Usage: rootfs-delta.sh
+
+command -v zstd > /dev/null || { echo "no zstd, skipped"; exit 77; }
+
+tmp=$(mktemp -d)
+trap 'rm -rf $tmp' EXIT
+storage=$tmp/storage
+eval "$(sed -n '/^apply_rootfs_delta() {/,/^}/p' "$(dirname "$0")/../update.sh" | sed "s|/tmp/storage|$storage|g")"
+
+# a reference image and a new one with a few changed blocks and some appended data, like a rebuild
+head -c 16M /dev/urandom > $tmp/old.squashfs
+cp $tmp/old.squashfs $tmp/new.squashfs
+for off in 1 700 2000 4000; do
+    head -c 4096 /dev/urandom | dd of=$tmp/new.squashfs bs=4096 seek=$off conv=notrunc status=none
+done
+head -c 1M /dev/urandom >> $tmp/new.squashfs
+zstd -q -19 -T0 --long=30 -f --patch-from=$tmp/old.squashfs $tmp/new.squashfs -o $tmp/new.squashfs.delta || exit 1
+echo "delta $(stat -c %s $tmp/new.squashfs.delta) bytes for a $(stat -c %s $tmp/new.squashfs) byte image"
+
+sha() {
+    sha256sum $1 | cut -d' ' -f1
+}
+
+# setup <slot holding the reference, or none>: slot 1 gets the delta as the swu writes it
+setup() {
+    rm -rf $storage
+    mkdir -p $storage/bsp/0 $storage/bsp/1
+    [ "$1" = none ] || cp $tmp/old.squashfs $storage/bsp/$1/rootfs.squashfs
+    cp $tmp/new.squashfs.delta $storage/bsp/1/rootfs.squashfs.delta
+}
+
+fail=0
+check() {
+    if eval "$2"; then
+        echo "ok: $1"
+    else
+        echo "FAIL: $1"
+        fail=1
+    fi
+}
+
+UPDATE_SLOT=1
+DELTA_BASE_SHA256=$(sha $tmp/old.squashfs)
+
+setup 0
+ROOTFS_SHA256=$(sha $tmp/new.squashfs)
+apply_rootfs_delta > /dev/null
+check "rebuilt from the other slot" "[ \$? = 0 ] && cmp -s $tmp/new.squashfs $storage/bsp/1/rootfs.squashfs"
+check "delta removed" "[ ! -e $storage/bsp/1/rootfs.squashfs.delta ] && [ ! -e $storage/bsp/1/rootfs.squashfs.tmp ]"
+
+setup 1
+apply_rootfs_delta > /dev/null
+check "rebuilt over the reference in the update slot" "[ \$? = 0 ] && cmp -s $tmp/new.squashfs $storage/bsp/1/rootfs.squashfs"
+
+setup 0
+ROOTFS_SHA256=$(sha $tmp/old.squashfs)
+apply_rootfs_delta > /dev/null
+check "wrong checksum fails" "[ \$? = 1 ] && [ ! -e $storage/bsp/1/rootfs.squashfs ] && [ ! -e $storage/bsp/1/rootfs.squashfs.tmp ]"
+
+setup none
+ROOTFS_SHA256=$(sha $tmp/new.squashfs)
+apply_rootfs_delta > /dev/null
+check "missing reference fails" "[ \$? = 1 ] && [ ! -e $storage/bsp/1/rootfs.squashfs ]"
+
+rm -rf $storage
+mkdir -p $storage/bsp/1
+cp $tmp/new.squashfs $storage/bsp/1/rootfs.squashfs
+apply_rootfs_delta > /dev/null
+check "full image left alone" "[ \$? = 0 ] && cmp -s $tmp/new.squashfs $storage/bsp/1/rootfs.squashfs"
+
+exit $fail
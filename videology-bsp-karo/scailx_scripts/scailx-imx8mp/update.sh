@@ -25,12 +25,21 @@ function get_slot {
     fi
 }
 
+# part_dev <label>: the block device of a partition, from the links udev creates. findfs is not in
+# the initramfs, and this does not rescan every block device.
+part_dev() {
+    for l in /dev/disk/by-label/$1 /dev/disk/by-partlabel/$1; do
+        [ -e $l ] && readlink -f $l && return 0
+    done
+    return 1
+}
+
 format_disk() {
     # get the primary disk
     for i in `cat /proc/cmdline`; do
         [[ $i == primary-disk=* ]] && dev="${i: -1}"
     done
-    [ -b "$dev" ] || dev=$(findfs LABEL=boot || findfs LABEL=root || findfs LABEL=rootfs); dev=$(echo $dev | sed -r 's/p?[0-9]*$//')
+    [ -b "$dev" ] || dev=$(part_dev boot || part_dev root || part_dev rootfs); dev=$(echo $dev | sed -r 's/p?[0-9]*$//')
     [ -b "$dev" ] || (echo "not a block device: $dev" && return 1)
     # unmount everything on the disk
     umount -f /boot;     umount -f /rootfs;     umount -f /storage;
@@ -48,28 +57,82 @@ EOF
 
 	udevadm settle
 
-    mkfs.ext4 "$(findfs PARTLABEL=boot)" -L boot
-	mkfs.ext4 "$(findfs PARTLABEL=storage)" -L storage
+    mkfs.ext4 "$(part_dev boot)" -L boot
+	mkfs.ext4 "$(part_dev storage)" -L storage
+}
+
+# merge_tree <src> <dst>: move everything in src into dst with renames. A directory only missing in
+# dst moves as a whole, only directories in both are walked, and entries in src replace dst's.
+# Nothing is copied, so the xattrs and whiteouts of an overlay upper dir move along unchanged.
+merge_tree() {
+    local src=$1 dst=$2 e name
+    mkdir -p "$dst"
+    for e in "$src"/* "$src"/.[!.]* "$src"/..?*; do
+        [ -e "$e" ] || [ -L "$e" ] || continue
+        name=${e##*/}
+        if [ -d "$e" ] && [ ! -L "$e" ] && [ -d "$dst/$name" ] && [ ! -L "$dst/$name" ]; then
+            merge_tree "$e" "$dst/$name"
+        else
+            [ -d "$dst/$name" ] && [ ! -L "$dst/$name" ] && rm -rf "$dst/$name"
+            mv -f "$e" "$dst/$name"
+        fi
+    done
+    rmdir "$src" 2> /dev/null
+}
+
+# Rebuild rootfs.squashfs of the update slot from a delta swu. The delta is against the release with
+# sha256 DELTA_BASE_SHA256, which one of the slots should still hold.
+apply_rootfs_delta() {
+    dir=/tmp/storage/bsp/$UPDATE_SLOT
+    [ -f $dir/rootfs.squashfs.delta ] || return 0
+
+    base=""
+    for f in /tmp/storage/bsp/*/rootfs.squashfs; do
+        [ -f "$f" ] || continue
+        [ "$(sha256sum $f | cut -d' ' -f1)" = "$DELTA_BASE_SHA256" ] && base=$f && break
+    done
+    if [ -z "$base" ]; then
+        echo "no slot holds the rootfs this delta is for ($DELTA_BASE_SHA256), install the full update"
+        return 1
+    fi
+    zstd -q -d -f --long=30 --patch-from=$base $dir/rootfs.squashfs.delta -o $dir/rootfs.squashfs.tmp || return 1
+    rm -f $dir/rootfs.squashfs.delta
+    if [ "$(sha256sum $dir/rootfs.squashfs.tmp | cut -d' ' -f1)" != "$ROOTFS_SHA256" ]; then
+        echo "rebuilt rootfs does not match $ROOTFS_SHA256"
+        rm -f $dir/rootfs.squashfs.tmp
+        return 1
+    fi
+    sync
+    mv -f $dir/rootfs.squashfs.tmp $dir/rootfs.squashfs
 }
 
 if [ $1 == "preinst" ]; then
     # get the current root device
     get_slot
-    DISK=$(findfs LABEL=boot | sed -r 's/p?[0-9]*$//')
-    [ -b $DISK ] || exit 1
+    DISK=$(part_dev boot | sed -r 's/p?[0-9]*$//')
+    [ -n "$DISK" ] && [ -b "$DISK" ] || exit 1
 
     # create a symlink for the update process
     mkdir -p /tmp/storage
     mount /dev/disk/by-label/storage /tmp/storage || (umount -f /tmp/storage; mount /dev/disk/by-label/storage /tmp/storage)
     rm -rf /tmp/storage/bsp/$UPDATE_SLOT/*
     mkdir -p /tmp/storage/bsp/$UPDATE_SLOT/mounts
-    [ -d /tmp/storage/overlay/upper/etc ] && (mkdir -p /tmp/storage/config/persist/; cp -fr -t /tmp/storage/config/persist/ /tmp/storage/overlay/upper/etc)
-    rm -rf /tmp/storage/overlay/backup*
+    # keep the changes to /etc: moved into persist, which is a lower layer of the new root. From the
+    # booted system persist is also a lower layer of the running root, which overlayfs does not allow
+    # to change: upper/etc then goes into the backup with the rest, and the storage initramfs module
+    # merges it into persist on the next boot, before the overlay is mounted.
+    if [ -d /tmp/storage/overlay/upper/etc ] && ! grep -q 'upperdir=/storage/overlay/upper' /proc/mounts; then
+        merge_tree /tmp/storage/overlay/upper/etc /tmp/storage/config/persist/etc
+    fi
+    # the previous backup and the work dir are only moved to the trash here, storage-trash.service
+    # deletes them after the next boot, so swupdate can start streaming right away
+    mkdir -p /tmp/storage/overlay/trash
+    trash=$(mktemp -d /tmp/storage/overlay/trash/XXXXXX)
+    mv /tmp/storage/overlay/backup* /tmp/storage/overlay/work $trash/ 2> /dev/null
     mv -f /tmp/storage/overlay/upper /tmp/storage/overlay/backup
-    rm -rf /tmp/storage/overlay/work
-    # remove files in upper that are already in persist
-    persist_files=$(find /tmp/storage/config/persist/ -type f | sed -r 's/\/tmp\/storage\/config\/persist\///')
-    for f in $persist_files; do rm -f /tmp/storage/overlay/backup/$f; done
+    # remove files in the backup that are already in persist, etc/ is merged into persist as a whole
+    (cd /tmp/storage/config/persist && find . ! -type d ! -path './etc/*' -print0) | \
+        (cd /tmp/storage/overlay/backup && xargs -0 -r rm -f)
     # tarzip files in upper relative to upper
     # tar -C /tmp/storage/overlay/upper -czf /tmp/storage/backup.tgz .
 
@@ -78,19 +141,43 @@ if [ $1 == "preinst" ]; then
     rm -rf /tmp/update_boot/bsp${UPDATE_SLOT}/*
     # enable write on emmc boot partitions
     echo 0 > "/sys/block/mmcblk0boot${UPDATE_SLOT}/force_ro"
-    sync; umount -f /tmp/storage; umount -f /tmp/update_boot;
+    # the stable collection writes into these mounts, so nothing flushes between its artifacts and
+    # both partitions are written back at the same time. postinst syncs once and unmounts them.
+    if [ "$INSTALL_MOUNTED" != "1" ]; then
+        sync; umount -f /tmp/storage; umount -f /tmp/update_boot;
+    else
+        # otherwise the artifacts would land in the rootfs under the mount points
+        mountpoint -q /tmp/storage || exit 1
+        mountpoint -q /tmp/update_boot || exit 1
+    fi
 fi
 
 if [ $1 == "postinst" ]; then
     get_slot
-    DISK=$(findfs PARTLABEL=boot | sed -r 's/p?[0-9]*$//')
+    DISK=$(part_dev boot | sed -r 's/p?[0-9]*$//')
 
     # create partlabels for the devices created with the update in case they don't exist
     e2label /dev/disk/by-partlabel/storage 'storage'
     e2label /dev/disk/by-partlabel/boot    'boot'
 
+    mkdir -p /tmp/storage /tmp/update_boot
+    mountpoint -q /tmp/storage || mount /dev/disk/by-partlabel/storage /tmp/storage
+    mountpoint -q /tmp/update_boot || mount /dev/disk/by-partlabel/boot /tmp/update_boot
+    apply_rootfs_delta || { umount /tmp/storage; umount /tmp/update_boot; exit 1; }
+    # never switch to a slot that cannot boot
+    for f in /tmp/storage/bsp/$UPDATE_SLOT/rootfs.squashfs /tmp/update_boot/bsp$UPDATE_SLOT/Image-initramfs \
+             /tmp/update_boot/bsp$UPDATE_SLOT/boot.scr; do
+        if [ ! -s $f ]; then
+            echo "$f is missing, staying on the current slot"
+            umount /tmp/storage; umount /tmp/update_boot
+            exit 1
+        fi
+    done
+    # barrier: every artifact is on disk before the slot is switched
+    sync
+    umount /tmp/storage
+
     # Adjust u-boot-fw-utils for eMMC on the installed rootfs
-    mount /dev/disk/by-partlabel/boot /tmp/update_boot
     rm -f /tmp/update_boot/slot*
     echo "$UPDATE_SLOT" > /tmp/update_boot/slot$UPDATE_SLOT
     if which fw_setenv; then
@@ -98,13 +185,16 @@ if [ $1 == "postinst" ]; then
         fw_setenv fdt_file default.dtb
     fi
     if [ -n "$DEFAULT_DTB" ]; then
+        # base name of the pre-merged overlay variants boot.cmd looks for
+        which fw_setenv && fw_setenv fdt_base "${DEFAULT_DTB%.dtb}"
         ln -sf -T "${DEFAULT_DTB}" /tmp/update_boot/bsp${UPDATE_SLOT}/devicetree/default.dtb || cp -f "/tmp/update_boot/bsp${UPDATE_SLOT}/devicetree/${DEFAULT_DTB}" /tmp/update_boot/bsp${UPDATE_SLOT}/devicetree/default.dtb
         ln -sf -T "bsp${UPDATE_SLOT}/devicetree/${DEFAULT_DTB}" /tmp/update_boot/default.dtb || cp -f "/tmp/update_boot/bsp${UPDATE_SLOT}/devicetree/${DEFAULT_DTB}" /tmp/update_boot/default.dtb
         ln -sf -T "bsp${UPDATE_SLOT}/boot.scr" /tmp/update_boot/boot.scr
     fi
-    if which mmc; then
+    if which mmc && [ -n "$DISK" ] && [ -b "$DISK" ]; then
         # select the mmcblkXbootY partition based on UPDATE_SLOT
         # mmc bootpart enable <partition_number> <send_ack> </path/to/mmcblkX>
         mmc bootpart enable $(( $UPDATE_SLOT + 1 )) 1 ${DISK}
     fi
+    sync; umount /tmp/update_boot
 fi
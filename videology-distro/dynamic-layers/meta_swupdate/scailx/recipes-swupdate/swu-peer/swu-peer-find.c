@@ -0,0 +1,231 @@
+// SPDX-License-Identifier: MIT
+// One-shot mDNS browse for the swu peer cache, small enough for the initramfs where there is no
+// avahi-daemon. Sends one PTR query for the service from an ephemeral port, so the responders
+// (avahi on the cache nodes) answer by unicast, and prints each instance that answers as
+//     <ip> <port> [<txt>...]
+// in the order the answers arrive, which puts the closest peers first.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <poll.h>
+#include <time.h>
+#include <stdint.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define DEFAULT_SERVICE     "_scailx-swu._tcp.local"
+#define DEFAULT_TIMEOUT_MS  1000
+#define MDNS_ADDR           "224.0.0.251"
+#define MDNS_PORT           5353
+#define MAX_INSTANCES       64
+#define MAX_NAME            256
+
+#define TYPE_PTR    12
+#define TYPE_TXT    16
+#define TYPE_SRV    33
+
+struct instance {
+    char name[MAX_NAME];
+    char ip[INET_ADDRSTRLEN];
+    int port;
+    char txt[512];
+    int printed;
+};
+
+static struct instance found[MAX_INSTANCES];
+static int nfound;
+
+// read a possibly compressed name at *pos into out as dotted text, advance *pos past it
+static int read_name(const uint8_t *pkt, int len, int *pos, char *out)
+{
+    int p = *pos, jumped = 0, n = 0, hops = 0;
+
+    out[0] = 0;
+    while (p < len) {
+        uint8_t l = pkt[p];
+        if (l == 0) {
+            if (!jumped)
+                *pos = p + 1;
+            return 0;
+        }
+        if ((l & 0xc0) == 0xc0) {
+            if (p + 1 >= len || ++hops > 16)
+                return -1;
+            if (!jumped)
+                *pos = p + 2;
+            jumped = 1;
+            p = ((l & 0x3f) << 8) | pkt[p + 1];
+            continue;
+        }
+        if (p + 1 + l > len || n + l + 2 > MAX_NAME)
+            return -1;
+        if (n)
+            out[n++] = '.';
+        memcpy(out + n, pkt + p + 1, l);
+        n += l;
+        out[n] = 0;
+        p += 1 + l;
+    }
+    return -1;
+}
+
+// the instance called name, added if create is set
+static struct instance *instance(const char *name, int create)
+{
+    for (int i = 0; i < nfound; i++)
+        if (!strcasecmp(found[i].name, name))
+            return &found[i];
+    if (!create || nfound == MAX_INSTANCES)
+        return NULL;
+    struct instance *in = &found[nfound++];
+    memset(in, 0, sizeof(*in));
+    snprintf(in->name, sizeof(in->name), "%s", name);
+    return in;
+}
+
+// collect the PTR, SRV and TXT records of one response, the address is the responder's
+static void parse(const uint8_t *pkt, int len, const char *service, const char *ip)
+{
+    char name[MAX_NAME], target[MAX_NAME];
+    int pos = 12;
+
+    if (len < 12 || !(pkt[2] & 0x80))
+        return;
+    int qd = (pkt[4] << 8) | pkt[5];
+    int rr = ((pkt[6] << 8) | pkt[7]) + ((pkt[8] << 8) | pkt[9]) + ((pkt[10] << 8) | pkt[11]);
+
+    for (int i = 0; i < qd; i++) {
+        if (read_name(pkt, len, &pos, name))
+            return;
+        pos += 4;
+    }
+    for (int i = 0; i < rr; i++) {
+        if (read_name(pkt, len, &pos, name) || pos + 10 > len)
+            return;
+        int type = (pkt[pos] << 8) | pkt[pos + 1];
+        int rdlen = (pkt[pos + 8] << 8) | pkt[pos + 9];
+        int rdata = pos + 10;
+        pos = rdata + rdlen;
+        if (pos > len)
+            return;
+
+        struct instance *in;
+        if (type == TYPE_PTR && !strcasecmp(name, service)) {
+            int p = rdata;
+            if (!read_name(pkt, len, &p, target) && (in = instance(target, 1)))
+                snprintf(in->ip, sizeof(in->ip), "%s", ip);
+        } else if (type == TYPE_SRV && rdlen > 6 && (in = instance(name, 0))) {
+            in->port = (pkt[rdata + 4] << 8) | pkt[rdata + 5];
+        } else if (type == TYPE_TXT && (in = instance(name, 0))) {
+            int n = 0;
+            in->txt[0] = 0;
+            for (int p = rdata; p < rdata + rdlen; p += 1 + pkt[p]) {
+                int l = pkt[p];
+                if (!l || p + 1 + l > rdata + rdlen || n + l + 2 > (int)sizeof(in->txt))
+                    break;
+                n += sprintf(in->txt + n, "%s%.*s", n ? " " : "", l, pkt + p + 1);
+            }
+        }
+    }
+}
+
+static int query(int sock, const char *service)
+{
+    uint8_t pkt[512] = { 0 };
+    int n = 12;
+    char copy[MAX_NAME];
+
+    pkt[5] = 1;     // one question
+    snprintf(copy, sizeof(copy), "%s", service);
+    for (char *label = strtok(copy, "."); label; label = strtok(NULL, ".")) {
+        int l = strlen(label);
+        if (l > 63 || n + l + 6 > (int)sizeof(pkt))
+            return -1;
+        pkt[n++] = l;
+        memcpy(pkt + n, label, l);
+        n += l;
+    }
+    pkt[n++] = 0;
+    pkt[n++] = 0;
+    pkt[n++] = TYPE_PTR;
+    pkt[n++] = 0;
+    pkt[n++] = 1;   // IN
+
+    struct sockaddr_in to = { .sin_family = AF_INET, .sin_port = htons(MDNS_PORT) };
+    inet_pton(AF_INET, MDNS_ADDR, &to.sin_addr);
+    return sendto(sock, pkt, n, 0, (struct sockaddr *)&to, sizeof(to)) == n ? 0 : -1;
+}
+
+static long elapsed_ms(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *service = DEFAULT_SERVICE;
+    int timeout = DEFAULT_TIMEOUT_MS;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:h")) != -1) {
+        switch (opt) {
+        case 't': timeout = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-t timeout ms] [service, default %s]\n", argv[0], DEFAULT_SERVICE);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind < argc)
+        service = argv[optind];
+
+    int sock = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) {
+        perror("socket");
+        return 1;
+    }
+    unsigned char ttl = 255;
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    if (query(sock, service)) {
+        perror("mdns query");
+        return 1;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (;;) {
+        long left = timeout - elapsed_ms(&start);
+        if (left <= 0)
+            break;
+        struct pollfd pfd = { .fd = sock, .events = POLLIN };
+        if (poll(&pfd, 1, left) <= 0)
+            continue;
+
+        uint8_t pkt[9000];
+        struct sockaddr_in from;
+        socklen_t fromlen = sizeof(from);
+        int len = recvfrom(sock, pkt, sizeof(pkt), 0, (struct sockaddr *)&from, &fromlen);
+        if (len <= 0)
+            continue;
+        char ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &from.sin_addr, ip, sizeof(ip));
+        parse(pkt, len, service, ip);
+
+        // print instances as soon as they are complete
+        for (int i = 0; i < nfound; i++) {
+            struct instance *in = &found[i];
+            if (in->printed || !in->port)
+                continue;
+            printf("%s %d %s\n", in->ip, in->port, in->txt);
+            fflush(stdout);
+            in->printed = 1;
+        }
+    }
+    close(sock);
+    return 0;
+}
@@ -0,0 +1,49 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+# Stand-in for avahi on the cache nodes: answers every _scailx-swu._tcp PTR query, by unicast to the
+# asking port, with one instance per <port>:<txt>:... argument, until killed. Exits 77 when the mDNS
+# port cannot be bound.
+#
+# Usage: fake-mdns.py <port>:file=<name>:sha256=<sha>...
+import socket
+import struct
+import sys
+
+SERVICE = '_scailx-swu._tcp.local'
+
+
+def name(n):
+    return b''.join(bytes([len(l)]) + l.encode() for l in n.split('.')) + b'\0'
+
+
+def rr(n, t, data):
+    return name(n) + struct.pack('>HHIH', t, 1, 120, len(data)) + data
+
+
+def main():
+    s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    try:
+        s.bind(('', 5353))
+        s.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP,
+                     socket.inet_aton('224.0.0.251') + socket.inet_aton('0.0.0.0'))
+    except OSError as e:
+        print('fake-mdns:', e, file=sys.stderr)
+        return 77
+
+    answers, additional = b'', b''
+    for i, arg in enumerate(sys.argv[1:]):
+        port, *txt = arg.split(':')
+        inst = 'peer%d.%s' % (i, SERVICE)
+        answers += rr(SERVICE, 12, name(inst))
+        additional += rr(inst, 33, struct.pack('>HHH', 0, 0, int(port)) + name('peer%d.local' % i))
+        additional += rr(inst, 16, b''.join(bytes([len(t)]) + t.encode() for t in txt))
+    n = len(sys.argv) - 1
+    while True:
+        q, addr = s.recvfrom(1500)
+        if addr[1] != 5353:
+            s.sendto(struct.pack('>HHHHHH', 0, 0x8400, 0, n, 0, 2 * n) + answers + additional, addr)
+
+
+if __name__ == '__main__':
+    sys.exit(main())
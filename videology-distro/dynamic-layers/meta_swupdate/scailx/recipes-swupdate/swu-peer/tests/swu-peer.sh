@@ -0,0 +1,103 @@
+#!/bin/sh
+# Copyright (C) 2026/10/18 VideologyInc
+# Licensed on MIT
+
+# Host check of the LAN swu cache on one machine: local HTTP servers stand in for upstream and for
+# two peers, one of them serving a corrupt copy, and fake-mdns.py for avahi on the peers. Checks
+# that swu-peer-fetch takes a peer's copy only when it matches the upstream sha256, falls back to
+# upstream, and that swu-peer-cache announces the cache only while swu-peer-httpd runs. Several
+# units on a real network, avahi itself and swupdate installing the fetched file are not covered. Exits 77 (skipped) when the mDNS port or
+# the multicast group is not available.
+#
+# Usage: swu-peer.sh path/to/swu-peer-find
+
+here=$(dirname "$(readlink -f "$0")")
+find=$(readlink -f "$1")
+[ -x "$find" ] || { echo "usage: $0 path/to/swu-peer-find"; exit 1; }
+
+tmp=$(mktemp -d)
+pids=""
+trap 'kill $pids 2> /dev/null; rm -rf $tmp' EXIT
+
+# the scripts under test with swu-peer-find next to them, and the cache node paths in $tmp
+mkdir -p $tmp/bin $tmp/upstream $tmp/peer $tmp/bad $tmp/avahi
+ln -s $find $tmp/bin/swu-peer-find
+cp $here/../swu-peer-fetch $tmp/bin/
+sed -e "s|/storage/swu-cache|$tmp/cache|" -e "s|/etc/avahi/services|$tmp/avahi|" \
+    -e "s|/etc/default/swupdate|$tmp/swupdate.default|" $here/../swu-peer-cache > $tmp/bin/swu-peer-cache
+printf '#!/bin/sh\n[ -f %s/httpd-active ]\n' $tmp > $tmp/bin/systemctl
+chmod +x $tmp/bin/*
+PATH=$tmp/bin:$PATH
+export SWU_PEER_TIMEOUT=300
+
+NAME=scailx-image-swupdate-test.swu
+head -c 1M /dev/urandom > $tmp/upstream/$NAME
+SHA=$(sha256sum $tmp/upstream/$NAME | cut -d' ' -f1)
+echo "$SHA  $NAME" > $tmp/upstream/$NAME.sha256
+cp $tmp/upstream/$NAME $tmp/peer/
+head -c 1M /dev/urandom > $tmp/bad/$NAME
+
+port=$(( 20000 + $$ % 20000 ))
+for dir in upstream peer bad; do
+    python3 -m http.server $port -d $tmp/$dir > /dev/null 2>&1 &
+    pids="$pids $!"
+    eval ${dir}_port=$port
+    port=$(( port + 1 ))
+done
+URL=http://127.0.0.1:$upstream_port/$NAME
+for i in $(seq 50); do
+    curl -fsI -o /dev/null $URL && curl -fsI -o /dev/null http://127.0.0.1:$peer_port/$NAME && break
+    sleep 0.1
+done
+
+mdns_pid=""
+# announce <port> <sha>...: the peers fake-mdns.py answers with, none without arguments
+announce() {
+    [ -z "$mdns_pid" ] || { kill $mdns_pid; wait $mdns_pid 2> /dev/null; }
+    mdns_pid=""
+    [ $# -gt 0 ] || return 0
+    set -- $(while [ $# -gt 1 ]; do echo "$1:file=$NAME:sha256=$2"; shift 2; done)
+    python3 $here/fake-mdns.py "$@" &
+    mdns_pid=$!
+    pids="$pids $mdns_pid"
+    sleep 0.3
+    kill -0 $mdns_pid 2> /dev/null || { echo "mDNS port not available, skipped"; exit 77; }
+}
+
+fail=0
+check() {
+    if eval "$2"; then
+        echo "ok: $1"
+    else
+        echo "FAIL: $1"
+        fail=1
+    fi
+}
+
+announce $bad_port $SHA $peer_port $SHA
+peers=$(swu-peer-find -t 300)
+[ -n "$peers" ] || { echo "no mDNS answer over loopback multicast, skipped"; exit 77; }
+swu-peer-fetch $URL $tmp/out.swu > $tmp/log
+check "corrupt peer skipped, copy from the good one" "cmp -s $tmp/upstream/$NAME $tmp/out.swu && grep -q mismatch $tmp/log && ! grep -q 'from http' $tmp/log"
+
+announce $peer_port 0000$SHA
+rm -f $tmp/out.swu
+swu-peer-fetch $URL $tmp/out.swu > $tmp/log
+check "peer with another sha256 ignored" "cmp -s $tmp/upstream/$NAME $tmp/out.swu && grep -q 'from http' $tmp/log"
+
+announce
+rm -f $tmp/out.swu
+swu-peer-fetch $URL $tmp/out.swu > $tmp/log
+check "upstream without peers" "cmp -s $tmp/upstream/$NAME $tmp/out.swu"
+
+printf 'hardware="test"\nSWU_UPSTREAM="http://127.0.0.1:%s"\n' $upstream_port > $tmp/swupdate.default
+swu-peer-cache > /dev/null
+check "cache filled, not announced while httpd is stopped" "cmp -s $tmp/upstream/$NAME $tmp/cache/$NAME && [ ! -e $tmp/avahi/scailx-swu.service ]"
+touch $tmp/httpd-active
+swu-peer-cache > /dev/null
+check "announced while httpd runs" "grep -q 'sha256=$SHA' $tmp/avahi/scailx-swu.service"
+rm $tmp/httpd-active
+swu-peer-cache > /dev/null
+check "announcement removed when httpd stops" "[ ! -e $tmp/avahi/scailx-swu.service ]"
+
+exit $fail
@@ -0,0 +1,318 @@
+// SPDX-License-Identifier: MIT
+// Camera detection for the initramfs i2cdetect module.
+// Opens every CSI i2c bus once and probes all cam-overlays addresses with I2C_RDWR, one thread
+// per bus, instead of one i2cget fork per bus and address.
+//
+// cam-overlays: "<addr> <overlay> [<reg>=<value>]" per line. The optional id check reads <value>'s
+// width from <reg> (register width taken from the number of hex digits, so 0x300a is a 16-bit
+// register) and only matches when it reads back <value>. Entries without a check read register 0,
+// like 'i2cget -y bus addr 0x00'. Only the first matching entry is reported per bus and address,
+// so two camera types sharing an address can be told apart.
+//
+// With -c the result is cached as "<bus> <addr> <overlay> <id>" lines. On the next run each cached
+// camera gets one targeted probe; the buses are only rescanned if one of them no longer matches or
+// cam-overlays has changed since the cache was written.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+#define DEFAULT_BUS_FMT     "/dev/links/csi%d_i2c"
+#define DEFAULT_NUM_BUSES   6
+#define MAX_BUSES           16
+#define MAX_CAMS            32
+#define MAX_ID_LEN          4
+
+struct cam {
+    int addr;
+    char overlay[128];
+    unsigned char reg[2];
+    int reg_len;
+    unsigned char id[MAX_ID_LEN];
+    int id_len;             // 0: no id check
+};
+
+struct hit {
+    int cam;                // cams[] index
+    char id[2 * MAX_ID_LEN + 1];
+};
+
+struct bus {
+    int index;
+    char path[128];
+    struct hit hits[MAX_CAMS];
+    int nhits;
+};
+
+static struct cam cams[MAX_CAMS];
+static int ncams;
+static uint32_t cams_hash;
+static const char *bus_fmt = DEFAULT_BUS_FMT;
+static int nbuses = DEFAULT_NUM_BUSES;
+
+// "0x300a" -> {0x30, 0x0a}, width from the number of digits
+static int parse_hex_bytes(const char *s, unsigned char *out, int max) {
+    char *end;
+    unsigned long v;
+    int digits, len;
+
+    if (strncmp(s, "0x", 2) == 0 || strncmp(s, "0X", 2) == 0)
+        s += 2;
+    digits = strlen(s);
+    len = (digits + 1) / 2;
+    v = strtoul(s, &end, 16);
+    if (digits == 0 || *end || len > max)
+        return -1;
+    for (int i = len - 1; i >= 0; i--, v >>= 8)
+        out[i] = v & 0xff;
+    return len;
+}
+
+// Register read; returns the number of bytes read or -1 on NACK.
+static int read_reg(int fd, int addr, const unsigned char *reg, int reg_len, unsigned char *val, int len) {
+    struct i2c_msg msgs[2] = {
+        { .addr = addr, .flags = 0,        .len = reg_len, .buf = (unsigned char *)reg },
+        { .addr = addr, .flags = I2C_M_RD, .len = len,     .buf = val },
+    };
+    struct i2c_rdwr_ioctl_data data = { .msgs = msgs, .nmsgs = 2 };
+    union i2c_smbus_data byte;
+    struct i2c_smbus_ioctl_data smbus = {
+        .read_write = I2C_SMBUS_READ, .command = reg[0], .size = I2C_SMBUS_BYTE_DATA, .data = &byte,
+    };
+
+    if (ioctl(fd, I2C_RDWR, &data) == 2)
+        return len;
+    // SMBus-only adapters (and i2c-stub) have no plain i2c transfers, byte registers still work
+    if (errno != EOPNOTSUPP || reg_len != 1 || len != 1)
+        return -1;
+    if (ioctl(fd, I2C_SLAVE, addr) != 0 || ioctl(fd, I2C_SMBUS, &smbus) != 0)
+        return -1;
+    val[0] = byte.byte;
+    return 1;
+}
+
+// Probe one cam-overlays entry and fill in the id that was read. Returns 1 on a match.
+static int probe(int fd, const struct cam *c, char *id) {
+    static const unsigned char reg0 = 0;
+    unsigned char val[MAX_ID_LEN];
+    int len;
+
+    if (c->id_len)
+        len = read_reg(fd, c->addr, c->reg, c->reg_len, val, c->id_len);
+    else
+        len = read_reg(fd, c->addr, &reg0, 1, val, 1);
+    if (len < 0)
+        return 0;
+    if (c->id_len && memcmp(val, c->id, c->id_len) != 0)
+        return 0;
+    for (int i = 0; i < len; i++)
+        sprintf(id + 2 * i, "%02x", val[i]);
+    return 1;
+}
+
+static void *probe_bus(void *arg) {
+    struct bus *b = arg;
+    int fd = open(b->path, O_RDWR);
+
+    if (fd < 0)
+        return NULL;    // bus not present on this board
+    for (int i = 0; i < ncams; i++) {
+        int taken = 0;
+        for (int h = 0; h < b->nhits; h++)
+            taken |= cams[b->hits[h].cam].addr == cams[i].addr;
+        if (!taken && probe(fd, &cams[i], b->hits[b->nhits].id))
+            b->hits[b->nhits++].cam = i;
+    }
+    close(fd);
+    return NULL;
+}
+
+static int load_cams(const char *path) {
+    char line[256], check[64];
+    FILE *f = fopen(path, "r");
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    cams_hash = 2166136261u;
+    while (fgets(line, sizeof(line), f) && ncams < MAX_CAMS) {
+        struct cam *c = &cams[ncams];
+        char *eq;
+        int n;
+
+        for (char *p = line; *p; p++)
+            cams_hash = (cams_hash ^ (unsigned char)*p) * 16777619u;
+        n = sscanf(line, "%i %127s %63s", &c->addr, c->overlay, check);
+        if (n < 2 || c->addr <= 0 || c->addr >= 0x80 || c->overlay[0] == '#')
+            continue;
+        c->id_len = 0;
+        if (n == 3 && check[0] != '#') {
+            eq = strchr(check, '=');
+            if (eq)
+                *eq++ = 0;
+            if (!eq || (c->reg_len = parse_hex_bytes(check, c->reg, 2)) < 0 ||
+                (c->id_len = parse_hex_bytes(eq, c->id, MAX_ID_LEN)) < 0) {
+                fprintf(stderr, "%s: bad id check for %s, ignoring it\n", path, c->overlay);
+                c->id_len = 0;
+            }
+        }
+        ncams++;
+    }
+    fclose(f);
+    return 0;
+}
+
+static void scan(struct bus *buses) {
+    pthread_t threads[MAX_BUSES];
+
+    for (int b = 0; b < nbuses; b++) {
+        buses[b].index = b;
+        buses[b].nhits = 0;
+        snprintf(buses[b].path, sizeof(buses[b].path), bus_fmt, b);
+        if (pthread_create(&threads[b], NULL, probe_bus, &buses[b]) != 0) {
+            perror("pthread_create");
+            probe_bus(&buses[b]);
+            threads[b] = 0;
+        }
+    }
+    for (int b = 0; b < nbuses; b++)
+        if (threads[b])
+            pthread_join(threads[b], NULL);
+}
+
+// Re-probe each cached camera once and fill buses[] from the cache. Returns 0 if all of them still
+// match. Cameras attached to a previously empty port are only found by a rescan (-f).
+static int verify_cache(const char *path, struct bus *buses) {
+    char line[256], overlay[128], id[64], cur[2 * MAX_ID_LEN + 1];
+    unsigned int hash;
+    int bus, addr, fd = -1, cur_bus = -1, ret = 0;
+    FILE *f = fopen(path, "r");
+
+    if (!f)
+        return -1;
+    if (!fgets(line, sizeof(line), f) || sscanf(line, "# cam-overlays %x", &hash) != 1 || hash != cams_hash) {
+        fclose(f);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        struct bus *b;
+        int cam = -1;
+
+        if (sscanf(line, "%d %i %127s %63s", &bus, &addr, overlay, id) != 4 || bus < 0 || bus >= nbuses) {
+            ret = -1;
+            break;
+        }
+        for (int i = 0; i < ncams && cam < 0; i++)
+            if (cams[i].addr == addr && strcmp(cams[i].overlay, overlay) == 0)
+                cam = i;
+        b = &buses[bus];
+        if (bus != cur_bus) {
+            if (fd >= 0)
+                close(fd);
+            snprintf(b->path, sizeof(b->path), bus_fmt, bus);
+            fd = open(b->path, O_RDWR);
+            cur_bus = bus;
+        }
+        if (cam < 0 || fd < 0 || b->nhits >= MAX_CAMS || !probe(fd, &cams[cam], cur) || strcmp(cur, id) != 0) {
+            ret = -1;
+            break;
+        }
+        b->hits[b->nhits].cam = cam;
+        strcpy(b->hits[b->nhits++].id, cur);
+    }
+    if (fd >= 0)
+        close(fd);
+    fclose(f);
+    if (cur_bus < 0)
+        ret = -1;   // nothing cached, a camera may have been attached since
+    return ret;
+}
+
+static void print_hits(FILE *out, struct bus *buses) {
+    for (int b = 0; b < nbuses; b++)
+        for (int h = 0; h < buses[b].nhits; h++) {
+            struct hit *hit = &buses[b].hits[h];
+            fprintf(out, "%d 0x%02x %s %s\n", b, cams[hit->cam].addr, cams[hit->cam].overlay, hit->id);
+        }
+}
+
+static void write_cache(const char *path, struct bus *buses) {
+    char tmp[256];
+    FILE *f;
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    f = fopen(tmp, "w");
+    if (!f) {
+        perror(tmp);
+        return;
+    }
+    fprintf(f, "# cam-overlays %08x\n", cams_hash);
+    print_hits(f, buses);
+    if (fflush(f) != 0 || fsync(fileno(f)) != 0) {
+        perror(tmp);
+        fclose(f);
+        unlink(tmp);
+        return;
+    }
+    fclose(f);
+    if (rename(tmp, path) != 0)
+        perror(path);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-n buses] [-p bus-path-format] [-c cache [-f]] cam-overlays\n", prog);
+    fprintf(stderr, "Probes every address in cam-overlays on each CSI i2c bus and prints '<bus> <addr> <overlay> <id>'\n");
+    fprintf(stderr, "for each camera found.\n");
+    fprintf(stderr, "  -n N        number of buses (default %d)\n", DEFAULT_NUM_BUSES);
+    fprintf(stderr, "  -p FORMAT   bus device path, %%d is the bus index (default %s)\n", DEFAULT_BUS_FMT);
+    fprintf(stderr, "  -c CACHE    only re-probe the cameras in CACHE, rescan and rewrite it on a mismatch\n");
+    fprintf(stderr, "  -f          rescan and rewrite CACHE without checking it\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *cache = NULL;
+    struct bus buses[MAX_BUSES];
+    int force = 0, opt;
+
+    while ((opt = getopt(argc, argv, "n:p:c:fh")) != -1) {
+        switch (opt) {
+            case 'n': nbuses = atoi(optarg); break;
+            case 'p': bus_fmt = optarg; break;
+            case 'c': cache = optarg; break;
+            case 'f': force = 1; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind >= argc || nbuses < 1 || nbuses > MAX_BUSES) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (load_cams(argv[optind]) != 0)
+        return 1;
+
+    memset(buses, 0, sizeof(buses));
+    if (cache && !force && verify_cache(cache, buses) == 0) {
+        print_hits(stdout, buses);
+        return 0;
+    }
+    if (cache)
+        fprintf(stderr, "%s: rescanning camera buses\n", argv[0]);
+    memset(buses, 0, sizeof(buses));
+    scan(buses);
+    print_hits(stdout, buses);
+    fflush(stdout);
+    if (cache)
+        write_cache(cache, buses);
+    return 0;
+}
@@ -0,0 +1,44 @@
+#!/bin/sh
+# Copyright (C) 2026/10/18 VideologyInc
+# Licensed on MIT
+
+# Runs cam-detect against i2c-stub chips at 0x40 and 0x3c, all registers 0: the 0x40 entry has to be
+# found, the 0x3c entry not, as its id check wants 0x56. Then checks that a run with -c writes the
+# cache, and that the next run takes the cache instead of rescanning.
+# Needs root and the i2c-dev and i2c-stub modules, exits 77 (skipped) without them.
+#
+# Usage: cam-detect-i2c-stub.sh path/to/cam-detect
+
+detect=$1
+modprobe i2c-dev 2> /dev/null
+modprobe i2c-stub chip_addr=0x40,0x3c 2> /dev/null || { echo "i2c-stub not available, skipped"; exit 77; }
+tmp=$(mktemp -d)
+trap 'rmmod i2c-stub; rm -rf $tmp' EXIT
+
+for name in /sys/class/i2c-dev/*/name; do
+    grep -q "SMBus stub driver" $name && ln -s /dev/$(basename $(dirname $name)) $tmp/csi0_i2c
+done
+[ -e $tmp/csi0_i2c ] || { echo "FAIL: no i2c-stub bus"; exit 1; }
+cat > $tmp/cam-overlays <<EOF
+0x40 crosslink.dtbo
+0x3c ov5640.dtbo 0x0a=0x56
+0x36 os08a20.dtbo
+EOF
+
+expected="0 0x40 crosslink.dtbo 00"
+fail=0
+check() {
+    [ "$2" = "$expected" ] || { echo "FAIL: $1: got '$2', expected '$expected'"; fail=1; }
+}
+run() {
+    $detect -n 2 -p $tmp/csi%d_i2c "$@" $tmp/cam-overlays
+}
+
+check "scan" "$(run)"
+check "first cached run" "$(run -c $tmp/cache 2> $tmp/log)"
+grep -q rescanning $tmp/log || { echo "FAIL: first cached run did not scan"; fail=1; }
+check "cache hit" "$(run -c $tmp/cache 2> $tmp/log)"
+grep -q rescanning $tmp/log && { echo "FAIL: cache hit rescanned"; fail=1; }
+
+[ $fail = 0 ] && echo "ok"
+exit $fail
@@ -0,0 +1,55 @@
+#!/bin/bash
+# Copyright (C) 2026/10/18 VideologyInc
+# Licensed on MIT
+
+# Host check of storage_wait from the storage module: how long it takes to notice a partition link
+# that udev creates late, and that it gives up after roottimeout. Runs in a private mount namespace
+# with a tmpfs on /dev, udevadm stubbed to return at once so the polling fallback is what is timed.
+# Needs root for unshare, exits 77 (skipped) without it. No QEMU here: the boot-time number comes
+# from boot-profile on the target.
+#
+# Usage: storage-wait.sh
+
+if [ "$1" != "--inside" ]; then
+    unshare -m "$0" --inside 2> /dev/null
+    ret=$?
+    [ $ret = 0 ] || [ $ret = 1 ] || { echo "needs root and unshare, skipped"; exit 77; }
+    exit $ret
+fi
+mount -t tmpfs none /dev || exit 77
+
+debug() { :; }
+udevadm() { :; }
+. "$(dirname "$0")/../initramfs-framework/storage"
+bootparam_roottimeout=1
+
+now_ms() {
+    echo $(( $(date +%s%N) / 1000000 ))
+}
+
+fail=0
+# expect <name> <link after ms, empty for never> <expected return> <max ms>
+expect() {
+    rm -rf /dev/disk
+    mkdir -p /dev/disk/by-label /dev/disk/by-partlabel
+    touch /dev/mmcblk0p3
+    if [ -n "$2" ]; then
+        (sleep $(awk "BEGIN { print $2 / 1000 }"); ln -s ../../mmcblk0p3 /dev/disk/by-partlabel/storage) &
+    fi
+    start=$(now_ms)
+    storage_wait storage
+    ret=$?
+    took=$(( $(now_ms) - start ))
+    wait
+    if [ $ret != $3 ] || [ $took -gt $4 ]; then
+        echo "FAIL: $1: returned $ret after $took ms, expected $3 within $4 ms"
+        fail=1
+    else
+        echo "ok: $1: returned $ret after $took ms"
+    fi
+}
+
+expect "present" 0 0 100
+expect "appears after 300 ms" 300 0 450
+expect "never appears" "" 1 1300
+exit $fail
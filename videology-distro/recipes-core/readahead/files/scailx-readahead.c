@@ -0,0 +1,374 @@
+// SPDX-License-Identifier: MIT
+// Boot readahead for the squashfs root.
+//
+// record: watches the opens on the root mount with fanotify for a while after boot, then checks
+// which pages of each opened file are in the page cache (mincore) and writes them as a list:
+//     <offset>+<length>[,<offset>+<length>...] <path>
+// in the order the files were first opened. Only files that exist in the squashfs (-r, the /rofs
+// bind mount) are listed, files in the overlay upper or persist layers are not worth priming.
+//
+// replay: reads a list, changes to the squashfs root and forks. The child reads the ranges with
+// readahead() from a few threads, so the squashfs blocks are decompressed in parallel while the
+// initramfs finishes and systemd starts. Paths are opened relative to the working directory, so
+// the replay keeps going after switch_root has moved the mounts.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <limits.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sys/fanotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define DEFAULT_RECORD_TIME 60
+#define DEFAULT_ROFS        "/rofs"
+// resident runs closer than this are merged, one squashfs block is decompressed as a whole anyway
+#define MERGE_GAP           (128 * 1024)
+#define HASH_SIZE           (1 << 14)
+
+struct range {
+    uint64_t off;
+    uint64_t len;
+};
+
+struct entry {
+    char *path;
+    struct range *ranges;
+    int nranges;
+};
+
+static struct entry *entries;
+static int nentries;
+static int entries_size;
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s record [-t seconds] [-r rofs] -o list\n"
+            "       %s replay [-C dir] [-j threads] list\n", name, name);
+}
+
+static struct entry *add_entry(const char *path)
+{
+    if (nentries == entries_size) {
+        entries_size = entries_size ? entries_size * 2 : 256;
+        entries = realloc(entries, entries_size * sizeof(*entries));
+        if (!entries) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    struct entry *e = &entries[nentries++];
+    memset(e, 0, sizeof(*e));
+    e->path = strdup(path);
+    return e;
+}
+
+static void add_range(struct entry *e, uint64_t off, uint64_t len)
+{
+    if (e->nranges && e->ranges[e->nranges - 1].off + e->ranges[e->nranges - 1].len + MERGE_GAP >= off) {
+        e->ranges[e->nranges - 1].len = off + len - e->ranges[e->nranges - 1].off;
+        return;
+    }
+    e->ranges = realloc(e->ranges, (e->nranges + 1) * sizeof(*e->ranges));
+    if (!e->ranges) {
+        perror("realloc");
+        exit(1);
+    }
+    e->ranges[e->nranges].off = off;
+    e->ranges[e->nranges].len = len;
+    e->nranges++;
+}
+
+static long elapsed_ms(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+/* record */
+
+// set of paths already seen, open addressing on the FNV-1a hash
+static char *seen[HASH_SIZE];
+
+static int seen_add(const char *path)
+{
+    uint32_t h = 2166136261u;
+    for (const char *p = path; *p; p++)
+        h = (h ^ (unsigned char)*p) * 16777619u;
+    for (int i = 0; i < HASH_SIZE; i++) {
+        uint32_t slot = (h + i) & (HASH_SIZE - 1);
+        if (!seen[slot]) {
+            seen[slot] = strdup(path);
+            return 1;
+        }
+        if (!strcmp(seen[slot], path))
+            return 0;
+    }
+    return 0;       // full, more files than are worth priming
+}
+
+// the resident pages of rofs/path as ranges
+static void add_resident(struct entry *e, const char *rofs)
+{
+    char path[PATH_MAX];
+    long page = sysconf(_SC_PAGESIZE);
+    struct stat st;
+
+    snprintf(path, sizeof(path), "%s%s", rofs, e->path);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        close(fd);
+        return;
+    }
+    size_t pages = (st.st_size + page - 1) / page;
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return;
+    unsigned char *vec = malloc(pages);
+    if (vec && !mincore(map, st.st_size, vec)) {
+        for (size_t i = 0; i < pages; i++) {
+            if (!(vec[i] & 1))
+                continue;
+            size_t j = i;
+            while (j < pages && (vec[j] & 1))
+                j++;
+            add_range(e, (uint64_t)i * page, (uint64_t)(j - i) * page);
+            i = j;
+        }
+    }
+    free(vec);
+    munmap(map, st.st_size);
+}
+
+static int record(const char *out, const char *rofs, int seconds)
+{
+    char buf[8192] __attribute__((aligned(__alignof__(struct fanotify_event_metadata))));
+    char link[64], path[PATH_MAX];
+    struct timespec start;
+    pid_t self = getpid();
+
+    int fan = fanotify_init(FAN_CLASS_NOTIF | FAN_CLOEXEC | FAN_NONBLOCK, O_RDONLY | O_LARGEFILE | O_CLOEXEC);
+    if (fan < 0) {
+        perror("fanotify_init");
+        return 1;
+    }
+    if (fanotify_mark(fan, FAN_MARK_ADD | FAN_MARK_MOUNT, FAN_OPEN, AT_FDCWD, "/")) {
+        perror("fanotify_mark");
+        return 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (;;) {
+        long left = seconds * 1000L - elapsed_ms(&start);
+        if (left <= 0)
+            break;
+        struct pollfd pfd = { .fd = fan, .events = POLLIN };
+        if (poll(&pfd, 1, left) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            break;
+        }
+        ssize_t len;
+        while ((len = read(fan, buf, sizeof(buf))) > 0) {
+            struct fanotify_event_metadata *ev = (struct fanotify_event_metadata *)buf;
+            for (; FAN_EVENT_OK(ev, len); ev = FAN_EVENT_NEXT(ev, len)) {
+                if (ev->vers != FANOTIFY_METADATA_VERSION) {
+                    fprintf(stderr, "fanotify metadata version mismatch\n");
+                    return 1;
+                }
+                if (ev->fd < 0)
+                    continue;
+                if (ev->pid != self) {
+                    snprintf(link, sizeof(link), "/proc/self/fd/%d", ev->fd);
+                    ssize_t n = readlink(link, path, sizeof(path) - 1);
+                    if (n > 0) {
+                        path[n] = 0;
+                        if (seen_add(path))
+                            add_entry(path);
+                    }
+                }
+                close(ev->fd);
+            }
+        }
+    }
+    close(fan);
+
+    // only the pages still cached now were needed, and only the files in the squashfs are listed
+    char tmp[PATH_MAX];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", out);
+    FILE *f = fopen(tmp, "w");
+    if (!f) {
+        perror(tmp);
+        return 1;
+    }
+    int files = 0;
+    uint64_t total = 0;
+    for (int i = 0; i < nentries; i++) {
+        struct entry *e = &entries[i];
+        add_resident(e, rofs);
+        if (!e->nranges)
+            continue;
+        for (int r = 0; r < e->nranges; r++) {
+            fprintf(f, "%s%llu+%llu", r ? "," : "", (unsigned long long)e->ranges[r].off,
+                    (unsigned long long)e->ranges[r].len);
+            total += e->ranges[r].len;
+        }
+        fprintf(f, " %s\n", e->path);
+        files++;
+    }
+    if (fflush(f) || fsync(fileno(f)) || fclose(f) || rename(tmp, out)) {
+        perror(out);
+        unlink(tmp);
+        return 1;
+    }
+    printf("%d files, %llu KiB recorded to %s\n", files, (unsigned long long)(total / 1024), out);
+    return 0;
+}
+
+/* replay */
+
+static int next_entry;
+static uint64_t replayed;
+
+static void *replay_thread(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        int i = __atomic_fetch_add(&next_entry, 1, __ATOMIC_RELAXED);
+        if (i >= nentries)
+            break;
+        struct entry *e = &entries[i];
+        // relative to the squashfs root we changed to
+        int fd = open(e->path + (e->path[0] == '/'), O_RDONLY | O_CLOEXEC | O_NOATIME);
+        if (fd < 0)
+            continue;
+        for (int r = 0; r < e->nranges; r++) {
+            if (readahead(fd, e->ranges[r].off, e->ranges[r].len))
+                posix_fadvise(fd, e->ranges[r].off, e->ranges[r].len, POSIX_FADV_WILLNEED);
+            __atomic_fetch_add(&replayed, e->ranges[r].len, __ATOMIC_RELAXED);
+        }
+        close(fd);
+    }
+    return NULL;
+}
+
+static int load_list(const char *list)
+{
+    char line[PATH_MAX + 1024];
+    FILE *f = fopen(list, "r");
+    if (!f)
+        return -1;
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = 0;
+        char *path = strchr(line, ' ');
+        if (line[0] == '#' || !path)
+            continue;
+        *path++ = 0;
+        struct entry *e = add_entry(path);
+        for (char *tok = strtok(line, ","); tok; tok = strtok(NULL, ",")) {
+            unsigned long long off, len;
+            if (sscanf(tok, "%llu+%llu", &off, &len) == 2 && len)
+                add_range(e, off, len);
+        }
+        if (!e->nranges)
+            nentries--;
+    }
+    fclose(f);
+    return 0;
+}
+
+static int replay(const char *list, const char *dir, int nthreads)
+{
+    struct timespec start;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (load_list(list)) {
+        perror(list);
+        return 1;
+    }
+    if (chdir(dir)) {
+        perror(dir);
+        return 1;
+    }
+
+    // the caller only waits for the list to be loaded
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (pid > 0)
+        return 0;
+    setsid();
+
+    pthread_t threads[nthreads];
+    int started = 0;
+    for (int i = 0; i < nthreads; i++)
+        if (!pthread_create(&threads[i], NULL, replay_thread, NULL))
+            started++;
+    if (!started)
+        replay_thread(NULL);
+    for (int i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+
+    // goes to the kernel log, so boot-profile can show when it finished
+    FILE *kmsg = fopen("/dev/kmsg", "w");
+    if (kmsg) {
+        fprintf(kmsg, "scailx-readahead: done, %d files, %llu KiB in %ld ms\n", nentries,
+                (unsigned long long)(replayed / 1024), elapsed_ms(&start));
+        fclose(kmsg);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *out = NULL, *rofs = DEFAULT_ROFS, *dir = DEFAULT_ROFS;
+    int seconds = DEFAULT_RECORD_TIME;
+    long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char *cmd = argv[1];
+    optind = 2;
+    while ((opt = getopt(argc, argv, "t:r:o:C:j:h")) != -1) {
+        switch (opt) {
+        case 't': seconds = atoi(optarg); break;
+        case 'r': rofs = optarg; break;
+        case 'o': out = optarg; break;
+        case 'C': dir = optarg; break;
+        case 'j': nthreads = atoi(optarg); break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (nthreads < 1)
+        nthreads = 1;
+    if (nthreads > 16)
+        nthreads = 16;
+
+    if (!strcmp(cmd, "record") && out)
+        return record(out, rofs, seconds);
+    if (!strcmp(cmd, "replay") && optind < argc)
+        return replay(argv[optind], dir, nthreads);
+    usage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: MIT
+// udev helper for 99-scailx.rules, replacing the shell snippets that forked readlink, sed, cut,
+// ls, awk and strings for every i2c-dev/tty/spidev event.
+//
+//   scailx-alias <syspath>          print 'links/<alias>' for every /proc/device-tree/aliases entry
+//                                   pointing at the device's of_node, skipping the numbered
+//                                   i2cN/canN/serialN aliases
+//   scailx-alias --i2c-name <name>  write <name> to /dev/i2c_names/<link> for every link in
+//                                   $OF_SYMLINK
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <ctype.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#define ALIASES_DIR "/proc/device-tree/aliases"
+#define NAMES_DIR   "/dev/i2c_names"
+
+// i2c0, can1, serial2 ... are the kernel's own numbering aliases
+static int numbered_alias(const char *name) {
+    static const char *const prefixes[] = { "i2c", "can", "serial" };
+
+    for (unsigned i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); i++) {
+        size_t len = strlen(prefixes[i]);
+        if (strncmp(name, prefixes[i], len) == 0 && isdigit((unsigned char)name[len]))
+            return 1;
+    }
+    return 0;
+}
+
+static int print_aliases(const char *syspath) {
+    char link[PATH_MAX], target[PATH_MAX], value[PATH_MAX];
+    const char *node;
+    struct dirent *de;
+    DIR *dir;
+    ssize_t len;
+    int n = 0;
+
+    // .../firmware/devicetree/base/soc@0/... -> /soc@0/...
+    snprintf(link, sizeof(link), "%s/device/of_node", syspath);
+    len = readlink(link, target, sizeof(target) - 1);
+    if (len < 0)
+        return 0;
+    target[len] = 0;
+    node = strstr(target, "/base/");
+    if (!node)
+        return 0;
+    node += strlen("/base");
+
+    dir = opendir(ALIASES_DIR);
+    if (!dir)
+        return 0;
+    while ((de = readdir(dir))) {
+        int fd;
+
+        if (de->d_name[0] == '.' || numbered_alias(de->d_name))
+            continue;
+        snprintf(link, sizeof(link), ALIASES_DIR "/%s", de->d_name);
+        fd = open(link, O_RDONLY);
+        if (fd < 0)
+            continue;
+        len = read(fd, value, sizeof(value) - 1);
+        close(fd);
+        if (len <= 0)
+            continue;
+        value[len] = 0;     // property values are NUL terminated already
+        if (strcmp(value, node) == 0)
+            printf("%slinks/%s", n++ ? " " : "", de->d_name);
+    }
+    closedir(dir);
+    if (n)
+        printf("\n");
+    return 0;
+}
+
+static int write_i2c_names(const char *name) {
+    const char *links = getenv("OF_SYMLINK");
+    char buf[PATH_MAX], path[PATH_MAX], *tok, *save;
+    int ret = 0;
+
+    if (!links || !*links)
+        return 0;
+    mkdir(NAMES_DIR, 0755);
+    snprintf(buf, sizeof(buf), "%s", links);
+    for (tok = strtok_r(buf, " ", &save); tok; tok = strtok_r(NULL, " ", &save)) {
+        const char *base = strrchr(tok, '/');
+        FILE *f;
+
+        snprintf(path, sizeof(path), NAMES_DIR "/%s", base ? base + 1 : tok);
+        f = fopen(path, "w");
+        if (!f) {
+            perror(path);
+            ret = 1;
+            continue;
+        }
+        fprintf(f, "%s\n", name);
+        fclose(f);
+    }
+    return ret;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc == 3 && strcmp(argv[1], "--i2c-name") == 0)
+        return write_i2c_names(argv[2]);
+    if (argc == 2)
+        return print_aliases(argv[1]);
+    fprintf(stderr, "Usage: %s <syspath> | --i2c-name <name>\n", argv[0]);
+    return 1;
+}
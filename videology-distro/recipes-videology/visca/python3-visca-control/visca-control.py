@@ -1,268 +1,326 @@
-#!/usr/bin/env python
-
-# https://www.youtube.com/watch?v=dgvLegLW6ek
-
-# webserver.py
-# https://www.youtube.com/watch?v=Lbfe3-v7yE0
-# server.py client.py
-
-from http.server import HTTPServer, BaseHTTPRequestHandler
-import cgi
-import serial
-
-tasklist = ['Task 1', 'Task 2', 'Task 3']
-
-class requestHandler(BaseHTTPRequestHandler):
-    def do_GET(self):
-        if self.path.startswith('/'):
-            self.send_response(200)
-            self.send_header('content-type', 'text/html')
-            self.end_headers()
-
-            output =''
-            output += '<html><body>'
-            output += '<form method="POST" enctype="multipart/form-data" action="/imx8/CAM_Zoom/Tele">'
-            output += '<input type = "submit" value="Tele">'
-            output += '</form>'
-            output += '<form method="POST" enctype="multipart/form-data" action="/imx8/CAM_Zoom/Wide">'
-            output += '<input type = "submit" value="Wide">'
-            output += '</form>'
-            output += '<form method="POST" enctype="multipart/form-data" action="/imx8/CAM_Zoom/Stop">'
-            output += '<input type = "submit" value="Stop">'
-            output += '</form>'
-            output += '<form method="POST" enctype="multipart/form-data" action="/imx8/CAM_MENUKey/MENU">'
-            output += '<input type = "submit" value="MENU">'
-            output += '</form>'
-            output += '<form method="POST" enctype="multipart/form-data" action="/imx8/CAM_MENUKey/ESC">'
-            output += '<input type = "submit" value="ESC">'
-            output += '</form>'
-            output += '<form method="POST" enctype="multipart/form-data" action="/imx8/CAM_MENUKey/UP">'
-            output += '<input type = "submit" value="UP">'
-            output += '</form>'
-            output += '<form method="POST" enctype="multipart/form-data" action="/imx8/CAM_MENUKey/DOWN">'
-            output += '<input type = "submit" value="DOWN">'
-            output += '</form>'
-            output += '<form method="POST" enctype="multipart/form-data" action="/imx8/CAM_MENUKey/LEFT">'
-            output += '<input type = "submit" value="LEFT">'
-            output += '</form>'
-            output += '<form method="POST" enctype="multipart/form-data" action="/imx8/CAM_MENUKey/RIGHT">'
-            output += '<input type = "submit" value="RIGHT">'
-            output += '</form>'
-            output += '<form method="POST" enctype="multipart/form-data" action="/imx8/CAM_POWER">'
-            output += '<input type = "submit" value="RESET">'
-            output += '</form>'
-            output += '</form>'
-            output += '<form method="POST" enctype="multipart/form-data" action="/imx8/CAM_LR_REVERSE/ON">'
-            output += '<input type = "submit" value="MIRROR ON">'
-            output += '</form>'
-            output += '</form>'
-            output += '<form method="POST" enctype="multipart/form-data" action="/imx8/CAM_LR_REVERSE/OFF">'
-            output += '<input type = "submit" value="MIRROR OFF">'
-            output += '</form>'
-            output += '</form>'
-            output += '<form method="POST" enctype="multipart/form-data" action="/imx8/CAM_PICTURE_FLIP/ON">'
-            output += '<input type = "submit" value="FLIP ON">'
-            output += '</form>'
-            output += '</form>'
-            output += '<form method="POST" enctype="multipart/form-data" action="/imx8/CAM_PICTURE_FLIP/OFF">'
-            output += '<input type = "submit" value="FLIP OFF">'
-            output += '</form>'
-            output += '</form>'
-            output += '<form method="POST" enctype="multipart/form-data" action="/imx8/CAM_AF_MODE/NORMAL_AF">'
-            output += '<input type = "submit" value="NORMAL AF">'
-            output += '</form>'
-            output += '</form>'
-            output += '<form method="POST" enctype="multipart/form-data" action="/imx8/CAM_AF_MODE/INTERVAL_AF">'
-            output += '<input type = "submit" value="INTERVAL AF">'
-            output += '</form>'
-            output += '</form>'
-            output += '<form method="POST" enctype="multipart/form-data" action="/imx8/CAM_AF_MODE/ZOOM_TRIG_AF">'
-            output += '<input type = "submit" value="ZOOM AF">'
-            output += '</form>'
-            output += '</body></html>'
-#            output += '<form method="POST" enctype="multipart/form-data" action="/imx8/CAM_WDR/ON">'
-#            output += '<input type = "submit" value="WDR ON">'
-#            output += '</form>'
-#            output += '</body></html>'
-#            output += '<form method="POST" enctype="multipart/form-data" action="/imx8/CAM_WDR/OFF">'
-#            output += '<input type = "submit" value="WDR OFF">'
-#            output += '</form>'
-#            output += '</body></html>'
-            output += '<form method="POST" enctype="multipart/form-data" action="/imx8/CAM_ICR/NIGHT">'
-            output += '<input type = "submit" value="ICR NIGHT">'
-            output += '</form>'
-            output += '</body></html>'
-            output += '<form method="POST" enctype="multipart/form-data" action="/imx8/CAM_ICR/DAY">'
-            output += '<input type = "submit" value="ICR DAY">'
-            output += '</form>'
-            output += '</body></html>'
-            self.wfile.write(output.encode())
-
-
-        if self.path.endswith('/tasklist'):
-            self.send_response(200)
-            self.send_header('content-type', 'text/html')
-            self.end_headers()
-
-            output =''
-            output += '<html><body>'
-            output += '<h1>Task List</h1>'
-            output += '<h3><a href="/tasklist/new">Add New Task</a></h3>'
-            for task in tasklist:
-                output += task
-                output += '<a href="/tasklist/%s/remove">X</a>' % task
-                output += '</br>'
-            output += '</body></html>'
-            self.wfile.write(output.encode())
-
-        if self.path.endswith('/remove'):
-            listIDPath = self.path.split('/')[2]
-            print(listIDPath)
-            self.send_response(200)
-            self.send_header('content-type', 'text/html')
-            self.end_headers()
-
-            output =''
-            output += '<html><body>'
-            output += '<h1>Remove task: %s</h1>' % listIDPath.replace('%20', ' ')
-            output += '<form method = "POST" enctype = "multipart/form-data" action = "/tasklist/%s/remove">' % listIDPath
-            output += '<input type = "submit" value="Remove"></form>'
-            output += '<a href="/tasklist">Cancel</a>'
-            output += '</body></html>'
-            self.wfile.write(output.encode())
-
-
-        if self.path.endswith('/new'):
-            self.send_response(200)
-            self.send_header('content-type', 'text/html')
-            self.end_headers()
-
-            output = ''
-            output += '<html><body>'
-            output += '<h1>Add New Task</h1>'
-
-            output += '<form method="POST" enctype="multipart/form-data" action="/tasklist/new">'
-            output += '<input name="task" type="text" placeholder="Add new task">'
-            output += '<input type="submit" value="Add">'
-            output += '</form>'
-            output += '</body></html>'
-
-            self.wfile.write(output.encode())
-
-
-    def do_POST(self):
-
-        if self.path.startswith('/imx8'):
-            z = self.path.rsplit('/')
-            print(z)
-            if z[2] == 'CAM_POWER':
-               ser=serial.Serial('/dev/ttymxc1')
-               ser.write(b'\x81\x01\x04\x00\x03\xFF')
-            if z[2] == 'CAM_Zoom':
-               if z[3] == 'Stop':
-                  ser=serial.Serial('/dev/ttymxc1')
-                  ser.write(b'\x81\x01\x04\x07\x00\xFF')
-               if z[3] == 'Tele':
-                  ser=serial.Serial('/dev/ttymxc1')
-                  ser.write(b'\x81\x01\x04\x07\x02\xFF')
-               if z[3] == 'Wide':
-                  ser=serial.Serial('/dev/ttymxc1')
-                  ser.write(b'\x81\x01\x04\x07\x03\xFF')
-            if z[2] == 'CAM_MENUKey':
-               if z[3] == 'MENU':
-                  ser=serial.Serial('/dev/ttymxc1')
-                  ser.write(b'\x81\x01\x04\x16\x10\xFF')
-               if z[3] == 'ESC':
-                  ser=serial.Serial('/dev/ttymxc1')
-                  ser.write(b'\x81\x01\x04\x16\x20\xFF')
-               if z[3] == 'UP':
-                  ser=serial.Serial('/dev/ttymxc1')
-                  ser.write(b'\x81\x01\x04\x16\x01\xFF')
-               if z[3] == 'DOWN':
-                  ser=serial.Serial('/dev/ttymxc1')
-                  ser.write(b'\x81\x01\x04\x16\x02\xFF')
-               if z[3] == 'RIGHT':
-                  ser=serial.Serial('/dev/ttymxc1')
-                  ser.write(b'\x81\x01\x04\x16\x08\xFF')
-               if z[3] == 'LEFT':
-                  ser=serial.Serial('/dev/ttymxc1')
-                  ser.write(b'\x81\x01\x04\x16\x04\xFF')
-            if z[2] == 'CAM_LR_REVERSE':
-               if z[3] == 'ON':
-                  ser=serial.Serial('/dev/ttymxc1')
-                  ser.write(b'\x81\x01\x04\x61\x02\xFF')
-               if z[3] == 'OFF':
-                  ser=serial.Serial('/dev/ttymxc1')
-                  ser.write(b'\x81\x01\x04\x61\x03\xFF')
-            if z[2] == 'CAM_PICTURE_FLIP':
-               if z[3] == 'ON':
-                  ser=serial.Serial('/dev/ttymxc1')
-                  ser.write(b'\x81\x01\x04\x66\x02\xFF')
-               if z[3] == 'OFF':
-                  ser=serial.Serial('/dev/ttymxc1')
-                  ser.write(b'\x81\x01\x04\x66\x03\xFF')
-#            if z[2] == 'CAM_WDR':
-#               if z[3] == 'ON':
-#                  ser=serial.Serial('/dev/ttymxc1')
-#                  ser.write(b'\x81\x01\x04\x3D\x02\xFF')
-#               if z[3] == 'OFF':
-#                  ser=serial.Serial('/dev/ttymxc1')
-#                  ser.write(b'\x81\x01\x04\x3D\x03\xFF')
-            if z[2] == 'CAM_ICR':
-               if z[3] == 'NIGHT':
-                  ser=serial.Serial('/dev/ttymxc1')
-                  ser.write(b'\x81\x01\x04\x01\x02\xFF')
-               if z[3] == 'DAY':
-                  ser=serial.Serial('/dev/ttymxc1')
-                  ser.write(b'\x81\x01\x04\x01\x03\xFF')
-#            self.send_response(200)
-#            self.send_header('content-type', 'text/html')
-#            self.end_headers()
-
-#            output =''
-#            output += '<html><body>'
-#            output += '<h1>Task List</h1>'
-#            output += '<h3><a href="/tasklist/new">IMX8 SoM</a></h3>'
-#            output += '</body></html>'
-#            self.wfile.write(output.encode())
-            self.send_response(301)
-            self.send_header('content-type', 'text/html')
-            self.send_header('Location', '/')
-            self.end_headers()
-        if self.path.endswith('/new'):
-            ctype, pdict =  cgi.parse_header(self.headers.get('content-type'))
-            pdict['boundary'] = bytes(pdict['boundary'], "utf-8")
-            content_len = int(self.headers.get('Content-length'))
-            pdict['CONTENT-LENGTH'] = content_len
-            if ctype == 'multipart/form-data':
-                fields = cgi.parse_multipart(self.rfile, pdict)
-                new_task = fields.get('task')
-                tasklist.append(new_task[0])
-
-            self.send_response(301)
-            self.send_header('content-type', 'text/html')
-            self.send_header('Location', '/tasklist')
-            self.end_headers()
-
-        if self.path.endswith('/remove'):
-            listIDPath = self.path.split('/')[2]
-            ctype, pdict =  cgi.parse_header(self.headers.get('content-type'))
-            if ctype == 'multipart/form-data':
-                list_item = listIDPath.replace('%20', ' ')
-                tasklist.remove(list_item)
-            self.send_response(301)
-            self.send_header('content-type', 'text/html')
-            self.send_header('Location', '/tasklist')
-            self.end_headers()
+#!/usr/bin/env python3
+
+# HTTP control service for VISCA cameras.
+# One asyncio loop keeps the serial port open, queues commands from all clients and coalesces
+# repeated state-setting commands (e.g. zoom Tele/Wide) that have not been sent yet.
+#
+# GET  /                          static control page
+# GET  /api/commands              {"group": ["action", ...], ...}
+# POST /api/command/<group>[/<action>]
+# POST /imx8/<group>[/<action>]   form posts from older pages, redirects back to /
+# GET  /api/events                server-sent events with zoom/focus positions, only changed values
+
+import argparse
+import asyncio
+import itertools
+import json
+import os
+import termios
+import tty
+from collections import OrderedDict
+from html import escape
+
+# group -> action -> VISCA command. action '' is for groups without one.
+COMMANDS = {
+    'CAM_Zoom': {
+        'Tele': '8101040702FF',
+        'Wide': '8101040703FF',
+        'Stop': '8101040700FF',
+    },
+    'CAM_MENUKey': {
+        'MENU': '8101041610FF',
+        'ESC': '8101041620FF',
+        'UP': '8101041601FF',
+        'DOWN': '8101041602FF',
+        'LEFT': '8101041604FF',
+        'RIGHT': '8101041608FF',
+    },
+    'CAM_POWER': {
+        '': '8101040003FF',
+    },
+    'CAM_LR_REVERSE': {
+        'ON': '8101046102FF',
+        'OFF': '8101046103FF',
+    },
+    'CAM_PICTURE_FLIP': {
+        'ON': '8101046602FF',
+        'OFF': '8101046603FF',
+    },
+    'CAM_AF_MODE': {
+        'NORMAL_AF': '8101045700FF',
+        'INTERVAL_AF': '8101045701FF',
+        'ZOOM_TRIG_AF': '8101045702FF',
+    },
+    'CAM_ICR': {
+        'NIGHT': '8101040102FF',
+        'DAY': '8101040103FF',
+    },
+}
+
+# groups where only the latest unsent command matters. Menu keys and reset must all be sent.
+COALESCE = {'CAM_Zoom', 'CAM_LR_REVERSE', 'CAM_PICTURE_FLIP', 'CAM_AF_MODE', 'CAM_ICR'}
+
+LABELS = {
+    ('CAM_POWER', ''): 'RESET',
+    ('CAM_LR_REVERSE', 'ON'): 'MIRROR ON', ('CAM_LR_REVERSE', 'OFF'): 'MIRROR OFF',
+    ('CAM_PICTURE_FLIP', 'ON'): 'FLIP ON', ('CAM_PICTURE_FLIP', 'OFF'): 'FLIP OFF',
+    ('CAM_AF_MODE', 'NORMAL_AF'): 'NORMAL AF', ('CAM_AF_MODE', 'INTERVAL_AF'): 'INTERVAL AF',
+    ('CAM_AF_MODE', 'ZOOM_TRIG_AF'): 'ZOOM AF',
+    ('CAM_ICR', 'NIGHT'): 'ICR NIGHT', ('CAM_ICR', 'DAY'): 'ICR DAY',
+}
+
+# inquiries polled for the live position display. Replies are 90 50 0p 0q 0r 0s FF.
+INQUIRIES = {
+    'zoom': '81090447FF',     # CAM_ZoomPosInq
+    'focus': '81090448FF',    # CAM_FocusPosInq
+}
+
+REPLY_TIMEOUT = 0.2     # seconds to wait for the ack of a command
+
+
+def command_name(group, action):
+    return '/'.join(p for p in (group, action) if p)
+
+
+def build_page():
+    """The page is static, so it is rendered once at startup."""
+    buttons = ''
+    for group, actions in COMMANDS.items():
+        buttons += '<div>'
+        for action in actions:
+            label = LABELS.get((group, action), action)
+            path = command_name(group, action)
+            buttons += '<button data-cmd="%s">%s</button>' % (escape(path), escape(label))
+        buttons += '</div>'
+    status = ''.join('<div>%s: <span id="%s">-</span></div>' % (name, name) for name in INQUIRIES)
+    page = ('<!DOCTYPE html><html><head><meta charset="utf-8"><title>VISCA control</title></head><body>'
+            + status + buttons +
+            '<script>'
+            'document.querySelectorAll("button[data-cmd]").forEach(function(b) {'
+            ' b.onclick = function() { fetch("/api/command/" + b.dataset.cmd, {method: "POST"}); };'
+            '});'
+            'new EventSource("/api/events").onmessage = function(e) {'
+            ' var d = JSON.parse(e.data);'
+            ' for (var k in d) { var el = document.getElementById(k); if (el) el.textContent = d[k]; }'
+            '};'
+            '</script></body></html>')
+    return page.encode()
+
+
+class ViscaPort:
+    """Keeps the serial port open. Replies are split on the 0xFF terminator."""
+
+    def __init__(self, path, baud):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+        tty.setraw(self.fd)
+        attrs = termios.tcgetattr(self.fd)
+        speed = getattr(termios, 'B%d' % baud)
+        attrs[4] = attrs[5] = speed
+        attrs[2] |= termios.CLOCAL | termios.CREAD
+        termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+        termios.tcflush(self.fd, termios.TCIFLUSH)
+        self.rx = bytearray()
+        self.replies = asyncio.Queue()
+        self.lock = asyncio.Lock()
+        asyncio.get_running_loop().add_reader(self.fd, self._on_readable)
+
+    def _on_readable(self):
+        try:
+            self.rx += os.read(self.fd, 256)
+        except BlockingIOError:
+            return
+        while 0xFF in self.rx:
+            end = self.rx.index(0xFF) + 1
+            self.replies.put_nowait(bytes(self.rx[:end]))
+            del self.rx[:end]
+
+    async def xfer(self, data, timeout=REPLY_TIMEOUT):
+        """Send one command and return its first reply, or None on timeout."""
+        async with self.lock:
+            while not self.replies.empty():
+                self.replies.get_nowait()
+            os.write(self.fd, data)
+            try:
+                return await asyncio.wait_for(self.replies.get(), timeout)
+            except asyncio.TimeoutError:
+                return None
+
+
+class CommandQueue:
+    """Pending commands in arrival order. A new command for a coalescing group replaces the unsent one."""
+
+    def __init__(self, port):
+        self.port = port
+        self.pending = OrderedDict()
+        self.ready = asyncio.Event()
+        self.seq = itertools.count()
+
+    def put(self, group, action):
+        key = group if group in COALESCE else (group, next(self.seq))
+        coalesced = key in self.pending
+        self.pending[key] = (group, action)
+        self.ready.set()
+        return coalesced
+
+    async def run(self):
+        while True:
+            await self.ready.wait()
+            while self.pending:
+                _, (group, action) = self.pending.popitem(last=False)
+                reply = await self.port.xfer(bytes.fromhex(COMMANDS[group][action]))
+                print('%s -> %s' % (command_name(group, action), reply.hex() if reply else 'no reply'), flush=True)
+            self.ready.clear()
+
+
+class PositionPoller:
+    """Polls the position inquiries on the shared port while clients are listening.
+    Commands go first: a poll round is skipped while commands are pending."""
+
+    def __init__(self, port, queue, rate):
+        self.port = port
+        self.queue = queue
+        self.interval = 1.0 / rate if rate > 0 else 0
+        self.state = {}
+        self.clients = set()
+
+    def subscribe(self):
+        client = asyncio.Queue()
+        self.clients.add(client)
+        if self.state:
+            client.put_nowait(dict(self.state))
+        return client
+
+    def unsubscribe(self, client):
+        self.clients.discard(client)
+
+    async def run(self):
+        if not self.interval:
+            return
+        while True:
+            await asyncio.sleep(self.interval)
+            if not self.clients or self.queue.pending:
+                continue
+            changed = {}
+            for name, inquiry in INQUIRIES.items():
+                reply = await self.port.xfer(bytes.fromhex(inquiry))
+                if not reply or len(reply) != 7 or reply[1] != 0x50:
+                    continue
+                value = (reply[2] & 0xF) << 12 | (reply[3] & 0xF) << 8 | (reply[4] & 0xF) << 4 | (reply[5] & 0xF)
+                if self.state.get(name) != value:
+                    self.state[name] = value
+                    changed[name] = value
+            if changed:
+                for client in self.clients:
+                    client.put_nowait(changed)
+
+
+class ControlServer:
+    def __init__(self, queue, poller):
+        self.queue = queue
+        self.poller = poller
+        self.page = build_page()
+        self.commands_json = json.dumps({g: list(a) for g, a in COMMANDS.items()}).encode()
+
+    def lookup(self, parts):
+        group = parts[0] if parts else ''
+        action = parts[1] if len(parts) > 1 else ''
+        if group in COMMANDS and action in COMMANDS[group]:
+            return group, action
+        return None
+
+    def route(self, method, path):
+        """Returns (status, content-type, body, extra headers)."""
+        parts = [p for p in path.split('?')[0].split('/') if p]
+        if method == 'GET' and not parts:
+            return '200 OK', 'text/html', self.page, {}
+        if method == 'GET' and parts == ['api', 'events']:
+            return '200 OK', 'text/event-stream', None, {'cache-control': 'no-cache'}
+        if method == 'GET' and parts == ['api', 'commands']:
+            return '200 OK', 'application/json', self.commands_json, {}
+        if method == 'POST' and parts[:2] == ['api', 'command']:
+            cmd = self.lookup(parts[2:])
+            if not cmd:
+                return '404 Not Found', 'application/json', b'{"error": "unknown command"}', {}
+            coalesced = self.queue.put(*cmd)
+            return '202 Accepted', 'application/json', json.dumps({'queued': command_name(*cmd), 'coalesced': coalesced}).encode(), {}
+        if method == 'POST' and parts[:1] == ['imx8']:
+            cmd = self.lookup(parts[1:])
+            if cmd:
+                self.queue.put(*cmd)
+            return '301 Moved Permanently', 'text/html', b'', {'Location': '/'}
+        return '404 Not Found', 'text/html', b'', {}
+
+    async def stream(self, reader, writer):
+        client = self.poller.subscribe()
+        # EOF on the request side means the client went away; polling stops with the last client.
+        closed = asyncio.ensure_future(reader.read())
+        try:
+            while True:
+                update = asyncio.ensure_future(client.get())
+                await asyncio.wait({update, closed}, return_when=asyncio.FIRST_COMPLETED)
+                if closed.done():
+                    update.cancel()
+                    break
+                writer.write(b'data: ' + json.dumps(update.result()).encode() + b'\n\n')
+                await writer.drain()
+        finally:
+            closed.cancel()
+            self.poller.unsubscribe(client)
+
+    async def handle(self, reader, writer):
+        try:
+            while True:
+                line = await reader.readline()
+                if not line:
+                    break
+                method, path, _ = line.decode('latin-1').split(' ', 2)
+                headers = {}
+                while True:
+                    h = await reader.readline()
+                    if h in (b'\r\n', b'\n', b''):
+                        break
+                    k, _, v = h.decode('latin-1').partition(':')
+                    headers[k.strip().lower()] = v.strip()
+                await reader.readexactly(int(headers.get('content-length') or 0))
+
+                status, ctype, body, extra = self.route(method, path)
+                if body is None:
+                    # event stream, runs until the client goes away
+                    head = 'HTTP/1.1 %s\r\ncontent-type: %s\r\n' % (status, ctype)
+                    head += ''.join('%s: %s\r\n' % kv for kv in extra.items())
+                    writer.write(head.encode() + b'\r\n')
+                    await self.stream(reader, writer)
+                    break
+                head = 'HTTP/1.1 %s\r\ncontent-type: %s\r\ncontent-length: %d\r\n' % (status, ctype, len(body))
+                head += ''.join('%s: %s\r\n' % kv for kv in extra.items())
+                writer.write(head.encode() + b'\r\n' + body)
+                await writer.drain()
+                if headers.get('connection', '').lower() == 'close':
+                    break
+        except (ConnectionError, asyncio.IncompleteReadError, ValueError):
+            pass
+        finally:
+            writer.close()
+
+
+async def serve(args):
+    port = ViscaPort(args.device, args.baud)
+    queue = CommandQueue(port)
+    poller = PositionPoller(port, queue, args.poll_rate)
+    server = ControlServer(queue, poller)
+    http = await asyncio.start_server(server.handle, '0.0.0.0', args.port)
+    print('Server running on port %s' % args.port, flush=True)
+    await asyncio.gather(http.serve_forever(), queue.run(), poller.run())
+
 
 def main():
-    ser = serial.Serial('/dev/ttymxc1', 9600)  # open serial port
-    PORT = 9000
-    server_address = ('0.0.0.0', PORT)
-    server = HTTPServer(server_address, requestHandler)
-    print('Server running on port %s' % PORT)
-    server.serve_forever()
+    parser = argparse.ArgumentParser(description='HTTP control service for VISCA cameras.')
+    parser.add_argument('--device', default='/dev/ttymxc1', help='serial port of the camera')
+    parser.add_argument('--baud', type=int, default=9600)
+    parser.add_argument('--port', type=int, default=9000, help='HTTP port')
+    parser.add_argument('--poll-rate', type=float, default=5, help='zoom/focus inquiries per second, 0 to disable')
+    asyncio.run(serve(parser.parse_args()))
 
-if __name__ == '__main__':
 
+if __name__ == '__main__':
     main()